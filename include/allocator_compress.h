@@ -0,0 +1,103 @@
+/**
+ * Iteration-periodic compression of block traces.
+ * Training repeats the same allocations every iteration, so one iteration
+ * is kept as a template of (malloc offset, lifetime, size) records and the
+ * other iterations are stored as their start op_id plus the records that
+ * differ from the template.
+*/
+#ifndef ALLOCATOR_COMPRESS_H
+#define ALLOCATOR_COMPRESS_H
+
+#include "allocator_utils.h"
+
+#include <functional>
+
+namespace c10 {
+namespace cuda {
+namespace AllocatorSim {
+
+// a block relative to the start of its iteration
+struct TraceRecord {
+    op_id_t malloc_offset;
+    op_id_t lifetime;       // free_op_id - malloc_op_id
+    size_t size;
+
+    TraceRecord() = default;
+
+    TraceRecord(op_id_t malloc_offset, op_id_t lifetime, size_t size)
+        : malloc_offset(malloc_offset), lifetime(lifetime), size(size) {}
+
+    bool operator==(const TraceRecord& other) const {
+        return malloc_offset == other.malloc_offset && lifetime == other.lifetime && size == other.size;
+    }
+
+    bool operator!=(const TraceRecord& other) const {
+        return !(*this == other);
+    }
+};
+
+struct TracePatch {
+    uint32_t index;         // indexes past the template extend the iteration
+    TraceRecord record;
+};
+
+struct IterationDelta {
+    op_id_t start_op_id;
+    uint32_t num_records;   // records past num_records of the template are dropped
+    std::vector<TracePatch> patches;
+};
+
+class compressedTrace {
+private:
+    std::vector<TraceRecord> template_records;
+    std::vector<IterationDelta> iterations;
+
+private:
+    // records[i] are the blocks allocated in [starts[i], starts[i + 1])
+    void encode_iterations(const std::vector<op_id_t>& starts,
+                           const std::vector<std::vector<TraceRecord>>& records);
+
+public:
+    // boundaries are the op_ids where the iterations end (allocatorMgr::iter_end),
+    // the blocks after the last boundary form a partial iteration
+    void encode(const trace_t& blocks, const std::vector<op_id_t>& boundaries);
+
+    // split the trace by the period of its malloc sizes when the boundaries are unknown
+    void encode(const trace_t& blocks);
+
+    // smallest period under which most of the sizes repeat, sizes.size() if none
+    static size_t detect_period(const std::vector<size_t>& sizes);
+
+    // fn(malloc_op_id, free_op_id, size) in malloc order
+    void for_each_block(const std::function<void(op_id_t, op_id_t, size_t)>& fn) const;
+
+    void decode(trace_t& blocks) const;
+
+    void clear();
+
+    bool empty() const;
+
+    void dump(const std::string& filename) const;
+
+    // false with error if filename is not a compressed trace or is truncated or inconsistent,
+    // the trace is left empty then
+    bool load(const std::string& filename, std::string& error);
+
+    // true if filename starts with the header of dump()
+    static bool is_compressed_file(const std::string& filename);
+
+    size_t get_num_iterations() const;
+
+    size_t get_num_blocks() const;
+
+    size_t get_num_patches() const;
+
+    // approximate heap usage of the compressed trace
+    size_t get_memory_bytes() const;
+};
+
+}  // namespace AllocatorSim
+}  // namespace cuda
+}  // namespace c10
+
+#endif  // ALLOCATOR_COMPRESS_H
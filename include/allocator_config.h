@@ -8,13 +8,13 @@
 #include <limits>
 #include <cstdint>
 #include <array>
+#include <vector>
 
 namespace c10 {
 namespace cuda {
 namespace AllocatorSim {
 
 #define CONFIG_NUMS 6
-#define GROUP_NUMS 5
 
 using SET_FUNC = void(*)(size_t);
 using GET_FUNC = size_t(*)();
@@ -35,14 +35,26 @@ private:
     static uint64_t m_memory_segment_address_start;
     static uint64_t m_memory_segment_address_interval;
 
+    // bumped by every setter, lets the simulator reload its cached configs
+    static uint64_t config_version;
+
 public:
     static std::array<SET_FUNC, CONFIG_NUMS> set_funcs;
     static std::array<GET_FUNC, CONFIG_NUMS> get_funcs;
 
-    // pair: <boundary, size>
-    static std::array<size_t, GROUP_NUMS> _GROUPS;
+    // the largest size of each group in ascending order, a grouped allocation takes the
+    // size of its group, empty without groups
+    static std::vector<size_t> _GROUPS;
+
+    static std::vector<size_t> BACKUP_GROUPS;
+
+    // the group size of a large allocation, 0 if it is larger than every group
+    static size_t get_group_size(size_t size);
+
+    // the same on the given groups instead of _GROUPS
+    static size_t get_group_size(const std::vector<size_t>& groups, size_t size);
 
-    static std::array<size_t, GROUP_NUMS> BACKUP_GROUPS;
+    static uint64_t get_config_version();
 
     static size_t get_kMinBlockSize();
 
@@ -0,0 +1,91 @@
+/**
+ * On-disk store of the searched configs, keyed by a workload signature, the
+ * search mode and the objective the configs were searched for.
+ * The signature is the sha256 of the malloc sizes of one iteration in order,
+ * with their histogram to compare workloads that are not the same. A job of
+ * the same workload, mode and objective reuses the stored configs without a
+ * search, a job of a similar workload warm-starts the search around them.
+ * Each entry is a text file of "name value" lines named by its key, with the
+ * search metadata.
+*/
+#ifndef ALLOCATOR_CONFIG_STORE_H
+#define ALLOCATOR_CONFIG_STORE_H
+
+#include "allocator_config.h"
+
+#include <array>
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace c10 {
+namespace cuda {
+namespace AllocatorSim {
+
+struct WorkloadSignature {
+    std::string hash;
+    // <size, number of mallocs> of the iteration
+    std::map<size_t, size_t> size_counts;
+
+    static WorkloadSignature from_sizes(const std::vector<size_t>& sizes);
+
+    // weighted Jaccard index of the size histograms, 1 for the same sizes
+    double similarity(const WorkloadSignature& other) const;
+};
+
+struct StoredConfigs {
+    WorkloadSignature signature;
+    // the values of allocatorConf::set_funcs in order
+    std::array<size_t, CONFIG_NUMS> configs {};
+    std::vector<size_t> groups;
+
+    // of the searched configs
+    size_t allocated_size = 0;
+    size_t reserved_size = 0;
+    double overhead_us = 0.0;
+
+    // search metadata, the mode and the objective are part of the key
+    std::string search_mode;
+    // the tradeoff and the latency model of the search as one word, see allocatorMgr
+    std::string objective;
+    size_t num_evaluated = 0;
+    double search_seconds = 0.0;
+    // signature of the entry the search started from, empty for a full search
+    std::string warm_start;
+    long long created = 0;
+};
+
+class configStore {
+private:
+    std::string directory;
+
+    bool load(const std::string& filename, StoredConfigs& entry, std::string& error) const;
+
+    std::string get_filename(const std::string& signature_hash, const std::string& search_mode,
+                             const std::string& objective) const;
+
+public:
+    // bumped when the entry format changes, entries of other versions are ignored
+    static const int VERSION = 2;
+
+    // far above the group counts searched, a larger count is a corrupt entry
+    static const size_t MAX_GROUPS = 4096;
+
+    explicit configStore(const std::string& directory);
+
+    // replaces the entry of the same key in one rename, false with the reason in error
+    bool save(const StoredConfigs& entry, std::string& error) const;
+
+    // the entry of the same signature, or else the most similar one with at least min_similarity,
+    // only entries of the same search_mode and objective are considered
+    bool find(const WorkloadSignature& signature, const std::string& search_mode,
+              const std::string& objective, double min_similarity,
+              StoredConfigs& entry, double& similarity) const;
+};
+
+}  // namespace AllocatorSim
+}  // namespace cuda
+}  // namespace c10
+
+#endif  // ALLOCATOR_CONFIG_STORE_H
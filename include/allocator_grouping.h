@@ -0,0 +1,42 @@
+/**
+ * Size groups of the large allocations.
+ * A grouped allocation takes a segment of the largest size of its group, so
+ * the segments of a group can be reused by all its sizes. The grouper splits
+ * the sorted distinct sizes into contiguous groups with the least rounding
+ * waste, each size weighted by how often it is requested, by dynamic
+ * programming over the split points instead of a difference threshold.
+*/
+#ifndef ALLOCATOR_GROUPING_H
+#define ALLOCATOR_GROUPING_H
+
+#include <cstddef>
+#include <map>
+#include <vector>
+
+namespace c10 {
+namespace cuda {
+namespace AllocatorSim {
+
+class sizeGrouper {
+private:
+    // <size, number of requests>
+    std::map<size_t, size_t> size_counts;
+    double waste = 0.0;
+
+public:
+    void add(size_t size, size_t count = 1);
+
+    // the largest size of each group in ascending order, at most num_groups of them
+    std::vector<size_t> partition(size_t num_groups);
+
+    // expected rounding bytes per request of the last partition
+    double get_waste() const;
+
+    size_t get_num_sizes() const;
+};
+
+}  // namespace AllocatorSim
+}  // namespace cuda
+}  // namespace c10
+
+#endif  // ALLOCATOR_GROUPING_H
@@ -0,0 +1,56 @@
+/**
+ * Latency model of the allocator calls.
+ * The simulator counts the calls that take time in a real allocator: segment
+ * allocations and releases (cudaMalloc and cudaFree), cache flushes, which
+ * synchronize the device, and pool lookups. The model turns the counts of a
+ * replay into an estimated allocator overhead, calibrated by a table file of
+ * "name value" lines measured on the target GPU.
+*/
+#ifndef ALLOCATOR_LATENCY_H
+#define ALLOCATOR_LATENCY_H
+
+#include <cstddef>
+#include <string>
+
+namespace c10 {
+namespace cuda {
+namespace AllocatorSim {
+
+// the timed allocator calls of a replay
+struct AllocatorOpCounts {
+    size_t segment_allocs = 0;
+    size_t segment_alloc_bytes = 0;
+    size_t segment_releases = 0;
+    size_t segment_release_bytes = 0;
+    size_t cache_flushes = 0;       // release_cached_blocks()
+    size_t pool_lookups = 0;        // get_free_block()
+
+    AllocatorOpCounts& operator+=(const AllocatorOpCounts& other);
+
+    AllocatorOpCounts operator-(const AllocatorOpCounts& other) const;
+
+    AllocatorOpCounts operator*(size_t n) const;
+
+    size_t get_segment_ops() const;
+};
+
+// in microseconds, the defaults are in the range of a recent datacenter GPU
+struct LatencyModel {
+    double segment_alloc_us = 150.0;
+    double segment_alloc_us_per_mb = 0.5;
+    double segment_release_us = 100.0;
+    double segment_release_us_per_mb = 0.3;
+    double cache_flush_us = 50.0;   // the device synchronization
+    double pool_lookup_us = 0.2;
+
+    double estimate_us(const AllocatorOpCounts& counts) const;
+
+    // "name value" lines named as the fields, # starts a comment, the missing names keep their values
+    bool load(const std::string& filename, std::string& error);
+};
+
+}  // namespace AllocatorSim
+}  // namespace cuda
+}  // namespace c10
+
+#endif  // ALLOCATOR_LATENCY_H
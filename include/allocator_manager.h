@@ -2,6 +2,19 @@
 #define ALLOCATOR_MANAGER_H
 
 #include "allocator_simulator.h"
+#include "allocator_planner.h"
+#include "allocator_tracer.h"
+#include "allocator_online.h"
+#include "allocator_search.h"
+#include "allocator_compress.h"
+#include "allocator_steady.h"
+#include "allocator_trace_file.h"
+#include "allocator_pareto.h"
+#include "allocator_grouping.h"
+#include "allocator_config_store.h"
+
+#include <atomic>
+#include <functional>
 
 namespace c10 {
 namespace cuda {
@@ -24,6 +37,8 @@ struct Configs {
 
     size_t allocated_size;
     size_t reserved_size;
+    // estimated allocator time per iteration in microseconds
+    double overhead_us = 0.0;
 
     Configs() = default;
 
@@ -72,18 +87,34 @@ struct Configs {
             kMinLargeAlloc, kRoundLarge, 0, 0, 0, 0.0, 0, 0, allocated_size, reserved_size) {}
 };
 
-typedef enum AllocatorEventType {
-    ALLOCATOR_MALLOC_BLOCK = 0,
-    ALLOCATOR_FREE_BLOCK = 1,
-    ALLOCATOR_MALLOC_SEGMENT = 2,
-    ALLOCATOR_RELEASE_SEGMENT = 3,
-    ALLOCATOR_EMPYT_CACHE = 4,
-    NUMS_OF_ALLOCATOR_EVENT = 5
-} AllocatorEventType_t;
+struct CallpathUsage {
+    size_t bytes = 0;           // block bytes after rounding
+    size_t requested_bytes = 0;
+    size_t num_blocks = 0;
+};
+
+// the live blocks at a memory peak, grouped by callpath
+struct PeakAttribution {
+    op_id_t op_id = 0;
+    size_t allocated_bytes = 0;
+    size_t reserved_bytes = 0;
+    size_t cached_small_bytes = 0;  // free blocks cached in the small pool
+    size_t cached_large_bytes = 0;  // free blocks cached in the large pool
+    std::map<std::string, CallpathUsage> callpaths;
+};
 
 // For torch.cuda.enable_profiling()
 void set_profiling_mode(bool mode);
 
+// how the config search weighs segment ops and fragmentation against reserved bytes
+void set_search_tradeoff(const SearchTradeoff& tradeoff);
+
+// calibrate the latency of the allocator calls from a table file, false if it cannot be read
+bool load_latency_model(const std::string& filename);
+
+// keep the searched configs in the directory and turn CONFIG_STORE on
+void set_config_store(const std::string& directory);
+
 class allocatorMgr {
 private:
     int device;
@@ -92,38 +123,86 @@ private:
     
 
     size_t current_reserved_size = std::numeric_limits<size_t>::max();
+    // tradeoff cost of the accepted configs, the reserved size by default
+    size_t current_cost = std::numeric_limits<size_t>::max();
+    // of the last simulate_allocator() or online simulation
+    ConfigCost replay_cost;
+    AllocatorOpCounts replay_op_counts;
+    // of the compiled trace, the allocator overhead is estimated per iteration,
+    // 0 until get_num_iterations() finds them
+    size_t num_iterations = 0;
+    // the evaluated configs of a search and the groups they were replayed with
+    paretoFront<std::pair<Configs, std::vector<size_t>>> pareto_front;
     
+    // per-thread event buffers of collect_trace, paired in flush_trace
+    allocatorTracer tracer;
+
     // <ptr, <op_id, size>>
     std::map<void*, std::pair<op_id_t, size_t>> _active_blocks;
     trace_t _block_trace;
     std::map<op_id_t, AllocatorEventType_t> _api_trace;
+    // the processed blocks when TRACE_COMPRESSION is on, _block_trace is emptied into it
+    compressedTrace compressed_trace;
 
     // not used, need to collect alloc_size if used
     // std::map<void*, std::pair<uint64_t, size_t>> _active_segments;
     // trace_t _segment_trace;
 
-    // <op_id, events>
-    std::map<op_id_t, AllocatorEventType_t> opid2event;
-    std::unordered_map<op_id_t, Block*> free_blocks;
+    // the trace compiled by process_trace, sorted by op_id, replayed by simulate_allocator
+    std::vector<ReplayEvent> replay_events;
+    std::vector<ReplaySlot> replay_slots;
+    // periods of replay_events skipped at a fixed point, when STEADY_STATE_DETECTION is on
+    steadyState steady_state;
+    // <ptr, block> of collect_trace_sync
+    std::unordered_map<uint64_t, Block*> free_blocks;
 
     // may not be used
     std::unordered_map<void*, uint64_t> realptr2simptr;
 
 
-    const std::set<size_t> kMinBlockSize_candidates {256, 512, 1024, 2048, 4096};
+    const std::set<size_t> kMinBlockSize_candidates {kMinBlockSize_grid.begin(), kMinBlockSize_grid.end()};
     const std::set<size_t> kSmallSize_candidates {1048576/2, 1048576, 1048576*3/2, 1048576*2};
     const std::set<size_t> kSmallBuffer_candidates {2097152, 2097152*2, 2097152*3, 2097152*4, 2097152*5};
     const std::set<size_t> kLargeBuffer_candidates {20971520/2, 20971520, 20971520*3/2, 20971520*2, 20971520*5/2};
     const std::set<size_t> kMinLargeAlloc_candidates {10485760*2, 10485760*4, 10485760*6, 10485760*8, 10485760*10};
-    const std::set<size_t> kRoundLarge_candidates {2097152, 2097152*2, 2097152*4, 2097152*8, 2097152*10, 2097152*12};
+    const std::set<size_t> kRoundLarge_candidates {kRoundLarge_grid.begin(), kRoundLarge_grid.end()};
     const std::set<float> GROUP_DIFFERENCES {0.2, 0.6, 1.2, 1.6, 2.0};
+    // numbers of groups of the searched partitions, the models with many large shapes need tens of them
+    const std::set<size_t> GROUP_COUNTS {1, 2, 4, 8, 16, 32, 64};
+    // only swept by the sensitivity analysis, max_split_size_mb is at least 20 in PyTorch
+    const std::set<size_t> max_split_size_candidates {
+        1048576*32, 1048576*64, 1048576*128, 1048576*256, 1048576*512, std::numeric_limits<size_t>::max()
+    };
 
     std::array<std::set<size_t>, CONFIG_NUMS> ALL_CANDIDATES = {
         kMinBlockSize_candidates, kSmallSize_candidates, kSmallBuffer_candidates,
         kLargeBuffer_candidates, kMinLargeAlloc_candidates, kRoundLarge_candidates
     };
 
-    float current_difference = 0.0;
+    // the grid of search_config and search_config_with_group, narrowed by the config store
+    std::array<std::set<size_t>, CONFIG_NUMS> search_candidates = ALL_CANDIDATES;
+    std::set<size_t> search_group_counts = GROUP_COUNTS;
+    // signature of the stored configs the search started from, empty for a full search
+    std::string warm_start;
+    std::chrono::steady_clock::time_point search_start;
+    // evaluate_allocator calls of the search
+    size_t num_evaluated = 0;
+
+    // exports the first replay when TIMELINE_EXPORTING is on
+    std::unique_ptr<allocatorTimeline> timeline;
+
+    // fed by collect_trace while online_active, ONLINE_SIMULATION is on, switched off after
+    // profiling but kept until the destructor, a collecting thread may still push to it
+    std::unique_ptr<allocatorOnlineSim> online_sim;
+    std::atomic<bool> online_active{false};
+    // of the finished online simulation, 0 if there was none
+    size_t online_reserved_size = 0;
+    size_t online_allocated_size = 0;
+
+    // running while BACKGROUND_SEARCH is on, reset once its result is applied
+    std::unique_ptr<allocatorSearch> background_search;
+    // a config search has finished, in the foreground or the background
+    bool configs_searched = false;
 
 private:
 
@@ -137,14 +216,49 @@ private:
 
     void report_configs(const Configs& conf1, const Configs& conf2);
 
-    // true means new config works
+    // true means new config works, the config is added to pareto_front either way
     bool evaluate_allocator(Configs configs, Configs prev_conf);
 
+    // print and dump pareto_front, the points with the cost of the last replay are marked
+    void report_pareto_front();
+
+    // the traced iterations, or the periods detected in the compiled trace on first use
+    size_t get_num_iterations();
+
+    // microseconds per iteration under the latency model
+    double get_overhead_us(const AllocatorOpCounts& counts);
+
     void allocator_assert(bool expr);
 
+    // pair the buffered malloc/free events into _active_blocks and _block_trace
+    void flush_trace();
+
+    // the callpath bookkeeping of the profiled events, in op_id order: the static tensor
+    // analysis, ptr2callpath and opid2callpath
+    void record_callpaths(const std::vector<TraceEvent>& events);
+
     void process_trace();
 
-    size_t simulate_allocator();
+    // move _block_trace into compressed_trace
+    void compress_trace();
+
+    // write the traced blocks in the binary trace format when TRACE_DUMPPING is on
+    void dump_trace();
+
+    // fn(malloc_op_id, free_op_id, size) of compressed_trace and _block_trace in malloc order
+    void for_each_traced_block(const std::function<void(op_id_t, op_id_t, size_t)>& fn);
+
+    // flatten the traced blocks and _api_trace into replay_events and replay_slots
+    void compile_trace();
+
+    // replay_events of replay_slots and _api_trace, the slots are in malloc order
+    void compile_events();
+
+    // replay the compiled trace, report it and search the configs
+    void replay_compiled_trace();
+
+    // on_op is called after each replayed op
+    size_t simulate_allocator(const std::function<void(op_id_t)>& on_op = nullptr);
 
     void search_config();
 
@@ -154,9 +268,66 @@ private:
 
     void group_blocks(const float& difference);
 
+    // the sizes of the replayed blocks in num_groups groups of the least rounding waste,
+    // each size weighted by its number of requests, returns the number of distinct large sizes
+    size_t group_blocks_by_waste(size_t num_groups);
+
+    // <callpath, malloc_op_id, free_op_id, size> of the allocations in an iteration
+    std::vector<PlanRequest> get_iteration_requests(size_t iter);
+
+    void plan_static_memory();
+
+    PeakAttribution capture_live_blocks(op_id_t op_id);
+
+    // replay the trace twice, the second time capturing the live blocks at the peaks
+    void attribute_peak_memory();
+
+    void report_peak_attribution(const std::string& title, const PeakAttribution& peak);
+
+    // attach a timeline exporter to the simulator for the next replay
+    void open_timeline();
+
+    void close_timeline();
+
+    void start_online_simulation();
+
+    // switch the online simulator off, wait for the pushed events and join its worker,
+    // return the max reserved size of the current configs, SIZE_MAX if it dropped events
+    size_t finish_online_simulation();
+
+    // log_configs of the current configs, with the online results if there was no replay
+    void log_original_configs();
+
+    // replay with each config and the group difference swept around the current configs,
+    // the others held fixed, when SENSITIVITY_ANALYSIS is on
+    void analyze_sensitivity();
+
+    // the malloc sizes of the last traced iteration, or of the last period of a trace file
+    WorkloadSignature get_workload_signature();
+
+    // the search tradeoff and the latency model in one word, stored configs are only reused
+    // for the same objective
+    std::string get_search_objective() const;
+
+    // the stored configs of the same workload alone, or the neighbours of the configs of a
+    // similar workload, searched in the same mode for the same objective, as the search grid
+    // when CONFIG_STORE is on, the whole grid otherwise
+    void lookup_config_store(const std::string& search_mode);
+
+    // the applied configs with the search metadata, unless they were reused as they were stored
+    void save_config_store(const std::string& search_mode);
+
+    // evaluate the candidate configs on a frozen copy of the compiled trace
+    void start_background_search();
+
+    void apply_background_search();
+
     bool iter_end();
 
     std::string get_callpath_hash();
+
+    // the python states and the backtrace, the text get_callpath_hash() hashes
+    std::string get_callpath();
     
     std::string get_python_states();
 
@@ -172,7 +343,7 @@ private:
 
     size_t get_grouped_allocation_size(size_t size);
 
-    void process_empty_cache_api();
+    void process_empty_cache_api(op_id_t op_id);
 
     void test_functionality_under_collect_trace_async();
 
@@ -198,12 +369,22 @@ public:
 
     void test_simulator();
 
+    // test_simulator() on the blocks and api events of a trace file instead of the collected ones,
+    // slots in malloc order, replayed as they are unless there are collected blocks to merge
+    void test_simulator(std::vector<ReplaySlot>&& slots, std::map<op_id_t, AllocatorEventType_t>&& api_trace = {});
+
     void collect_trace(void* ptr, int64_t size, bool real = false);
 
     void collect_api(AllocatorEventType_t api_type);
 
     bool iteration_trigger(bool begin = true);
 
+    // <evaluated, total> candidates of the background search, <0, 0> if none is running
+    std::pair<size_t, size_t> get_search_progress();
+
+    // false while a background search is running or before any search has finished
+    bool get_searched_configs(Configs& configs);
+
     char* malloc_cpu_memory_chunk(size_t size);
 
     void free_cpu_memory_chunk(char* pointer);
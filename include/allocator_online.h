@@ -0,0 +1,101 @@
+/**
+ * Online simulation of the allocator.
+ * collect_trace appends the events to per-thread trace buffers without locks
+ * and a background thread drains and replays them on one or more simulators,
+ * each pinned to its own configs, so the simulated state is current at the
+ * end of an iteration. The buffers are bounded, a worker too slow to keep
+ * them from filling up makes push() drop events instead of blocking the
+ * traced program, and the simulated state is incomplete (get_num_dropped()).
+*/
+#ifndef ALLOCATOR_ONLINE_H
+#define ALLOCATOR_ONLINE_H
+
+#include "allocator_simulator.h"
+#include "allocator_tracer.h"
+
+#include <condition_variable>
+#include <thread>
+
+namespace c10 {
+namespace cuda {
+namespace AllocatorSim {
+
+struct OnlineInstance {
+    allocatorSim sim;
+    // <ptr, block> of the blocks allocated by the traced program
+    std::unordered_map<void*, Block*> live_blocks;
+};
+
+class allocatorOnlineSim {
+private:
+    // pending events, size > 0: malloc, size < 0: free, size == 0: empty cache
+    allocatorTracer tracer;
+
+    // the worker state, never taken by push()
+    std::mutex state_mutex;
+    std::condition_variable wake;
+    std::condition_variable drained;
+
+    uint64_t num_processed = 0;
+    // sync() waits for a drain started after its request
+    uint64_t sync_requested = 0;
+    uint64_t sync_done = 0;
+    bool stopping = false;
+
+    std::vector<std::unique_ptr<OnlineInstance>> instances;
+    std::thread worker;
+
+private:
+    void run();
+
+    void process(const TraceEvent& event);
+
+public:
+    // at most max_pending_chunks chunks of TraceChunk::CAPACITY events wait for the worker
+    explicit allocatorOnlineSim(size_t num_preallocated_chunks = 16, size_t max_pending_chunks = 256);
+
+    ~allocatorOnlineSim();
+
+    // before start(), one simulator per configs
+    void add_instance(const SizingParams& params);
+
+    void start();
+
+    // process the remaining events and join the worker
+    void stop();
+
+    bool is_running() const;
+
+    // lock-free, the events of a thread and the events ordered by the program (a free after
+    // its malloc) are replayed in order, the events of unrelated threads in op_id order per drain
+    op_id_t push(void* ptr, int64_t size);
+
+    op_id_t push_empty_cache();
+
+    // wait until the events pushed before the call are simulated
+    void sync();
+
+    size_t get_num_instances() const;
+
+    const SizingParams& get_sizing_params(size_t i) const;
+
+    // after sync()
+    size_t get_max_reserved_bytes(size_t i);
+
+    size_t get_max_allocated_bytes(size_t i);
+
+    const AllocatorOpCounts& get_op_counts(size_t i);
+
+    size_t get_peak_fragmentation_bytes(size_t i);
+
+    uint64_t get_num_processed();
+
+    // events push() dropped on full buffers, the results are incomplete if any
+    uint64_t get_num_dropped() const;
+};
+
+}  // namespace AllocatorSim
+}  // namespace cuda
+}  // namespace c10
+
+#endif  // ALLOCATOR_ONLINE_H
@@ -0,0 +1,104 @@
+/**
+ * Pareto front of the searched configs.
+ * A config is kept while no other config is at least as good on peak reserved
+ * bytes, segment ops (the cudaMalloc and cudaFree calls, which synchronize the
+ * device) and internal fragmentation, and better on one of them. The search
+ * picks the point of the front with the smallest cost under a trade-off.
+*/
+#ifndef ALLOCATOR_PARETO_H
+#define ALLOCATOR_PARETO_H
+
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace c10 {
+namespace cuda {
+namespace AllocatorSim {
+
+// the objectives of a replayed config, all minimized
+struct ConfigCost {
+    size_t reserved_size = 0;
+    size_t segment_ops = 0;         // segment allocations and releases
+    size_t fragmentation = 0;       // rounding of the allocated blocks at the allocated peak
+
+    bool dominates(const ConfigCost& other) const {
+        return reserved_size <= other.reserved_size && segment_ops <= other.segment_ops &&
+            fragmentation <= other.fragmentation &&
+            (reserved_size < other.reserved_size || segment_ops < other.segment_ops ||
+             fragmentation < other.fragmentation);
+    }
+};
+
+// the reserved bytes a segment op and a byte of fragmentation are worth,
+// the default only looks at the reserved size
+struct SearchTradeoff {
+    size_t segment_op_bytes = 0;
+    double fragmentation_weight = 0.0;
+
+    // saturates instead of wrapping around
+    size_t cost(const ConfigCost& c) const {
+        const size_t max = std::numeric_limits<size_t>::max();
+        size_t total = c.reserved_size;
+        size_t ops = (segment_op_bytes == 0 || c.segment_ops <= max / segment_op_bytes)
+            ? c.segment_ops * segment_op_bytes : max;
+        double fragmentation = fragmentation_weight * static_cast<double>(c.fragmentation);
+        size_t weighted = fragmentation < static_cast<double>(max) ? static_cast<size_t>(fragmentation) : max;
+        total = (ops > max - total) ? max : total + ops;
+        return (weighted > max - total) ? max : total + weighted;
+    }
+};
+
+template <typename T>
+class paretoFront {
+private:
+    std::vector<std::pair<ConfigCost, T>> points;
+
+public:
+    // false if the point is dominated by or equal to one of the front,
+    // otherwise the points it dominates are dropped
+    bool insert(const ConfigCost& cost, const T& value) {
+        for (auto& p : points) {
+            if (p.first.dominates(cost) || (p.first.reserved_size == cost.reserved_size &&
+                p.first.segment_ops == cost.segment_ops && p.first.fragmentation == cost.fragmentation)) {
+                return false;
+            }
+        }
+        size_t kept = 0;
+        for (size_t i = 0; i < points.size(); i++) {
+            if (!cost.dominates(points[i].first)) {
+                points[kept++] = std::move(points[i]);
+            }
+        }
+        points.resize(kept);
+        points.emplace_back(cost, value);
+        return true;
+    }
+
+    // the point with the smallest cost, the first inserted one on ties, nullptr if empty
+    const std::pair<ConfigCost, T>* select(const SearchTradeoff& tradeoff) const {
+        const std::pair<ConfigCost, T>* best = nullptr;
+        for (auto& p : points) {
+            if (!best || tradeoff.cost(p.first) < tradeoff.cost(best->first)) {
+                best = &p;
+            }
+        }
+        return best;
+    }
+
+    // in insertion order
+    const std::vector<std::pair<ConfigCost, T>>& get_points() const {
+        return points;
+    }
+
+    void clear() {
+        points.clear();
+    }
+};
+
+}  // namespace AllocatorSim
+}  // namespace cuda
+}  // namespace c10
+
+#endif  // ALLOCATOR_PARETO_H
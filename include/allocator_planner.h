@@ -0,0 +1,90 @@
+/**
+ * Static memory planner of allocator.
+ * Computes a fixed arena offset for every allocation of one (stable) iteration
+ * and validates the plan against further iterations.
+*/
+#ifndef ALLOCATOR_PLANNER_H
+#define ALLOCATOR_PLANNER_H
+
+#include "allocator_utils.h"
+
+#include <string>
+
+namespace c10 {
+namespace cuda {
+namespace AllocatorSim {
+
+// an allocation is identified by its callpath and the occurrence index of
+// the callpath inside the iteration
+typedef std::pair<std::string, size_t> plan_key_t;
+
+struct PlanRequest {
+    std::string callpath;
+    op_id_t malloc_op_id;
+    op_id_t free_op_id;
+    size_t size;
+
+    PlanRequest() = default;
+
+    PlanRequest(const std::string& callpath, op_id_t malloc_op_id,
+                op_id_t free_op_id, size_t size)
+        : callpath(callpath),
+        malloc_op_id(malloc_op_id),
+        free_op_id(free_op_id),
+        size(size) {}
+};
+
+struct PlanEntry {
+    size_t offset;
+    size_t size;
+
+    PlanEntry() = default;
+
+    PlanEntry(size_t offset, size_t size) : offset(offset), size(size) {}
+};
+
+struct PlanValidation {
+    size_t num_allocations = 0;
+    size_t num_unplanned = 0;    // key not found in the plan
+    size_t num_oversized = 0;    // request larger than the planned slot
+    size_t num_overlaps = 0;     // two live allocations share planned bytes
+
+    bool is_valid() const {
+        return num_unplanned == 0 && num_oversized == 0 && num_overlaps == 0;
+    }
+};
+
+class allocatorPlanner {
+private:
+    std::map<plan_key_t, PlanEntry> plan;
+    size_t arena_size = 0;
+
+private:
+    // attach the occurrence index of each callpath (requests sorted by malloc op_id)
+    static std::vector<plan_key_t> make_keys(const std::vector<PlanRequest>& requests);
+
+public:
+    allocatorPlanner() = default;
+
+    // greedy-by-size offset assignment over the live ranges of one iteration
+    void build_plan(std::vector<PlanRequest> requests);
+
+    // replay another iteration on the planned offsets
+    PlanValidation validate(std::vector<PlanRequest> requests) const;
+
+    void dump_plan(const std::string& filename) const;
+
+    bool load_plan(const std::string& filename);
+
+    size_t get_arena_size() const;
+
+    size_t get_num_entries() const;
+
+    static void report_validation(size_t iteration, const PlanValidation& result);
+};
+
+}  // namespace AllocatorSim
+}  // namespace cuda
+}  // namespace c10
+
+#endif  // ALLOCATOR_PLANNER_H
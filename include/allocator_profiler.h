@@ -5,6 +5,7 @@
 #define ALLOCATOR_PROFILER_H
 
 #include "allocator_utils.h"
+#include "allocator_timeseries.h"
 
 #include <fstream>
 
@@ -109,6 +110,9 @@ struct SegmentInfo {
 
     std::vector<size_t> empty_range;
 
+    // sizes of the free blocks, for tracking the largest one on split/merge
+    std::multiset<size_t> free_sizes;
+
 
     SegmentInfo() = default;
 
@@ -126,7 +130,7 @@ struct SegmentInfo {
         largest_freed_size(0),
         num_blocks(0),
         num_allocated_blocks(0),
-        fragmentation(0) { empty_range = std::vector<size_t>(); }
+        fragmentation(0) { empty_range = std::vector<size_t>(); free_sizes = std::multiset<size_t>(); }
 
     SegmentInfo(const SegmentInfo& other)
         : op_id(other.op_id),
@@ -138,7 +142,8 @@ struct SegmentInfo {
         num_blocks(other.num_blocks),
         num_allocated_blocks(other.num_allocated_blocks),
         fragmentation(other.fragmentation),
-        empty_range(other.empty_range) {}
+        empty_range(other.empty_range),
+        free_sizes(other.free_sizes) {}
 
 
     bool operator<(const SegmentInfo& other) const {
@@ -178,18 +183,30 @@ private:
 
     std::map<size_t ,SnapShot> allocator_snapshot_history;
 
-    std::vector<OpInfo> op_list;
+    // the most recent ops only, the whole run is kept in time_series
+    RingBuffer<OpInfo> op_list = RingBuffer<OpInfo>(4096);
+
+    allocatorTimeSeries time_series;
 
-    std::vector<AllocatorInfo> allocator_info_history;
+    // sum of largest_freed_size over all segments
+    size_t total_largest_freed_size = 0;
 
-    std::map<uint64_t, bool> op_type_list;
+    // segment events of the current op, consumed by record_op
+    bool op_segment_alloc = false;
+    bool op_segment_release = false;
+    bool op_split = false;
 
 private:
 
     void update_status(Status& stat, int64_t amount);
 
+    // recompute largest_freed_size and fragmentation from the free block sizes
+    void update_segment_metrics(SegmentInfo& segment);
+
     void update_block_change(Block* block, const MemoryRange range, SegmentInfo& segment);
 
+    void record_op(bool is_free);
+
     MemoryRange locate_segment(Block* block);
 
     void dump_allocator_snapshot_history(std::string filename);
@@ -208,6 +225,19 @@ public:
     void update_block_allocate(Block* block);
 
     void update_block_free(Block* block, size_t size);
+
+    // block is the front part, remaining the back part of a split free block
+    void update_block_split(Block* block, Block* remaining);
+
+    // a free neighbor of subsumed_size is merged into block
+    void update_block_merge(Block* block, size_t subsumed_size);
+
+    // 1 - largest free block / free bytes, weighted over all segments
+    float get_fragmentation();
+
+    // reserved/allocated/segments curve with resolution ops per window
+    std::vector<SeriesWindow> query_time_series(size_t resolution,
+        op_id_t begin = 0, op_id_t end = std::numeric_limits<op_id_t>::max()) const;
 };
 
 
@@ -0,0 +1,49 @@
+/**
+ * Compiled trace replayed by the simulator.
+ * Events are sorted by op_id, a malloc and its free share a slot.
+*/
+#ifndef ALLOCATOR_REPLAY_H
+#define ALLOCATOR_REPLAY_H
+
+#include "allocator_utils.h"
+
+namespace c10 {
+namespace cuda {
+namespace AllocatorSim {
+
+typedef enum AllocatorEventType {
+    ALLOCATOR_MALLOC_BLOCK = 0,
+    ALLOCATOR_FREE_BLOCK = 1,
+    ALLOCATOR_MALLOC_SEGMENT = 2,
+    ALLOCATOR_RELEASE_SEGMENT = 3,
+    ALLOCATOR_EMPYT_CACHE = 4,
+    NUMS_OF_ALLOCATOR_EVENT = 5
+} AllocatorEventType_t;
+
+// a block of the compiled trace, shared by its malloc and free events
+struct ReplaySlot {
+    op_id_t malloc_op_id;
+    op_id_t free_op_id;
+    size_t size;
+    Block* block = nullptr;     // live between its malloc and free in a replay
+    bool has_free_event = true; // false if another event took its free op_id
+    size_t free_event = 0;      // index of the free event, if has_free_event
+
+    ReplaySlot(op_id_t malloc_op_id, op_id_t free_op_id, size_t size)
+        : malloc_op_id(malloc_op_id), free_op_id(free_op_id), size(size) {}
+};
+
+struct ReplayEvent {
+    op_id_t op_id;
+    AllocatorEventType_t type;
+    uint32_t slot;              // index in replay_slots, blocks only, compile_trace() rejects more slots
+
+    ReplayEvent(op_id_t op_id, AllocatorEventType_t type, uint32_t slot)
+        : op_id(op_id), type(type), slot(slot) {}
+};
+
+}  // namespace AllocatorSim
+}  // namespace cuda
+}  // namespace c10
+
+#endif  // ALLOCATOR_REPLAY_H
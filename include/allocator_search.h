@@ -0,0 +1,95 @@
+/**
+ * Background search of the allocator configs.
+ * A pool of threads replays a frozen copy of the compiled trace, one fresh
+ * simulator pinned to each candidate configs, while training continues.
+ * The manager applies the best configs at an iteration boundary.
+*/
+#ifndef ALLOCATOR_SEARCH_H
+#define ALLOCATOR_SEARCH_H
+
+#include "allocator_simulator.h"
+#include "allocator_replay.h"
+#include "allocator_steady.h"
+#include "allocator_pareto.h"
+
+#include <atomic>
+#include <thread>
+
+namespace c10 {
+namespace cuda {
+namespace AllocatorSim {
+
+struct SearchResult {
+    SizingParams params;
+    size_t allocated_size = 0;
+    size_t reserved_size = std::numeric_limits<size_t>::max();
+    size_t max_num_segments = 0;
+    size_t fragmentation = 0;
+    AllocatorOpCounts op_counts;
+
+    ConfigCost get_cost() const {
+        return ConfigCost{reserved_size, op_counts.get_segment_ops(), fragmentation};
+    }
+};
+
+class allocatorSearch {
+private:
+    int device;
+    int stream;
+
+    // frozen copy of the trace, Block* of the slots is not used
+    const std::vector<ReplayEvent> events;
+    const std::vector<ReplaySlot> slots;
+    const steadyState steady;
+    // groups applied when the search started, empty without groups
+    const std::vector<size_t> groups;
+
+    std::vector<SearchResult> candidates;
+
+    std::atomic<size_t> next_candidate{0};
+    std::atomic<size_t> num_evaluated{0};
+    std::atomic<bool> cancelled{false};
+    std::vector<std::thread> workers;
+
+private:
+    void run();
+
+    void evaluate(SearchResult& candidate);
+
+public:
+    allocatorSearch(int device, int stream,
+                    std::vector<ReplayEvent> events,
+                    std::vector<ReplaySlot> slots,
+                    steadyState steady,
+                    std::vector<size_t> groups,
+                    const std::vector<SizingParams>& params);
+
+    // cancels and joins a running search
+    ~allocatorSearch();
+
+    // num_threads = 0: a few threads, at most one per hardware thread, the training keeps the rest
+    void start(size_t num_threads = 0);
+
+    bool is_done() const;
+
+    void wait();
+
+    void cancel();
+
+    // <evaluated, total>
+    std::pair<size_t, size_t> get_progress() const;
+
+    const std::vector<size_t>& get_groups() const;
+
+    // after is_done()
+    const SearchResult& get_candidate(size_t i) const;
+
+    // after is_done(), the first candidate with the smallest cost, the smallest reserved size by default
+    const SearchResult& get_best(const SearchTradeoff& tradeoff = SearchTradeoff()) const;
+};
+
+}  // namespace AllocatorSim
+}  // namespace cuda
+}  // namespace c10
+
+#endif  // ALLOCATOR_SEARCH_H
@@ -9,7 +9,10 @@
 
 #include "allocator_utils.h"
 #include "allocator_config.h"
+#include "allocator_sizing.h"
 #include "allocator_profiler.h"
+#include "allocator_timeline.h"
+#include "allocator_latency.h"
 
 namespace c10 {
 namespace cuda {
@@ -44,9 +47,10 @@ public:
             auto range_size = it->end - it->start;
             if (range_size >= size) {
                 ptr = it->start;
+                auto range_end = it->end;
                 available_memory.erase(it);
                 if (range_size > size) {
-                    available_memory.insert(MemoryRange(ptr + size, it->end));
+                    available_memory.insert(MemoryRange(ptr + size, range_end));
                 }
                 allocated_memory.insert(MemoryRange(ptr, ptr + size));
                 return true;
@@ -85,6 +89,16 @@ private:
     size_t max_allocated_bytes;
     size_t current_allocated_bytes;
 
+    // op_id where the peaks are first reached
+    op_id_t max_reserved_op_id = 0;
+    op_id_t max_allocated_op_id = 0;
+    size_t max_num_segments = 0;
+    // the timed calls since reset_memory_usage()
+    AllocatorOpCounts op_counts;
+    // requested sizes of the allocated blocks, the rest of them is internal fragmentation
+    size_t current_requested_bytes = 0;
+    size_t peak_fragmentation_bytes = 0;
+
     deviceAllocator device_allocator;
 
     // <segment_ptr, first_block>: all the segments being able to release
@@ -95,9 +109,26 @@ private:
 
     allocatorProf* allocator_prof;
 
+    // op_id of the replayed event, set by the caller
+    op_id_t current_op_id = 0;
+
+    // not owned, nullptr if not exporting
+    allocatorTimeline* timeline = nullptr;
+
     bool group_enable_flag_sim = false;
 
+    // cached allocatorConf and the size functions specialized on it
+    SizingParams sizing_params;
+    const SizingFuncs* sizing_funcs;
+    uint64_t loaded_config_version;
+    // pinned simulators ignore later changes of allocatorConf
+    bool configs_pinned = false;
+    bool groups_pinned = false;
+    std::vector<size_t> pinned_groups;
+
 private:
+    void load_configs();
+
     size_t round_size(size_t ori_size);
 
     BlockPool& get_pool(size_t size, int stream);
@@ -145,14 +176,52 @@ public:
 
     std::pair<size_t, size_t> get_max_memory_usage();
 
+    // <allocated_bytes, reserved_bytes> at the current op
+    std::pair<size_t, size_t> get_current_memory_usage();
+
     size_t get_max_reserved_bytes();
 
     size_t get_max_allocated_bytes();
 
+    // <max_allocated_op_id, max_reserved_op_id>
+    std::pair<op_id_t, op_id_t> get_peak_op_ids();
+
+    // <small_pool_bytes, large_pool_bytes> of the cached free blocks
+    std::pair<size_t, size_t> get_cached_bytes();
+
+    // most segments reserved at once
+    size_t get_max_num_segments();
+
+    // segment allocations and releases since reset_memory_usage()
+    size_t get_num_segment_ops();
+
+    const AllocatorOpCounts& get_op_counts() const;
+
+    // rounding of the allocated blocks at the allocated peak
+    size_t get_peak_fragmentation_bytes();
+
     void reset_memory_usage();
 
     void set_group_enable_flag_sim(bool flag);
 
+    bool get_group_enable_flag_sim() const;
+
+    void set_op_id(op_id_t op_id);
+
+    void set_timeline(allocatorTimeline* timeline);
+
+    // simulate with params instead of allocatorConf, e.g. several configs side by side
+    void pin_configs(const SizingParams& params);
+
+    // group with a copy of groups instead of allocatorConf::_GROUPS, empty groups turn grouping off
+    void pin_groups(const std::vector<size_t>& groups);
+
+    const SizingParams& get_sizing_params() const;
+
+    // append what decides the later allocations: counters, segments and cached blocks,
+    // the allocated blocks are known by the caller
+    void get_state(std::vector<uint64_t>& state) const;
+
 };
 
 }  // namespace AllocatorSim
@@ -0,0 +1,92 @@
+/**
+ * Size computations of the simulator specialized on constant configurations.
+ * The divisors (kMinBlockSize, kRoundLarge) of the candidate grid are template
+ * parameters so the compiler turns the roundings into shifts and multiplies,
+ * the other parameters are plain comparisons against cached values.
+*/
+#ifndef ALLOCATOR_SIZING_H
+#define ALLOCATOR_SIZING_H
+
+#include <cstddef>
+#include <array>
+
+namespace c10 {
+namespace cuda {
+namespace AllocatorSim {
+
+// candidate grid of the divisors, shared with the config search
+constexpr std::array<size_t, 5> kMinBlockSize_grid {256, 512, 1024, 2048, 4096};
+constexpr std::array<size_t, 6> kRoundLarge_grid {
+    2097152, 2097152*2, 2097152*4, 2097152*8, 2097152*10, 2097152*12
+};
+
+// snapshot of allocatorConf used by the simulator hot path
+struct SizingParams {
+    size_t kMinBlockSize;
+    size_t kSmallSize;
+    size_t kSmallBuffer;
+    size_t kLargeBuffer;
+    size_t kMinLargeAlloc;
+    size_t kRoundLarge;
+    size_t max_split_size;
+    size_t roundup_power2_divisions;
+    size_t roundup_bypass_threshold;
+    double garbage_collection_threshold;
+};
+
+template <size_t N>
+struct ConstMinBlockSize {
+    static size_t get(const SizingParams&) { return N; }
+};
+
+struct RuntimeMinBlockSize {
+    static size_t get(const SizingParams& p) { return p.kMinBlockSize; }
+};
+
+template <size_t N>
+struct ConstRoundLarge {
+    static size_t get(const SizingParams&) { return N; }
+};
+
+struct RuntimeRoundLarge {
+    static size_t get(const SizingParams& p) { return p.kRoundLarge; }
+};
+
+template <typename MinBlockSize, typename RoundLarge>
+struct SizingPolicy {
+    static size_t round_size(const SizingParams& p, size_t size) {
+        const size_t min_block_size = MinBlockSize::get(p);
+        if (size < min_block_size) {
+            return min_block_size;
+        } else if (size > p.roundup_bypass_threshold) {
+            return min_block_size * ((size + min_block_size - 1) / min_block_size);
+        } else {
+            auto divisions = p.roundup_power2_divisions;
+            if (divisions > 0 && size > (min_block_size * divisions)) {
+                // not taken, see allocatorSim::round_size
+                return size;
+            } else {
+                return min_block_size * ((size + min_block_size - 1) / min_block_size);
+            }
+        }
+    }
+
+    static size_t round_large(const SizingParams& p, size_t size) {
+        const size_t round_large = RoundLarge::get(p);
+        return round_large * ((size + round_large - 1) / round_large);
+    }
+};
+
+struct SizingFuncs {
+    size_t (*round_size)(const SizingParams&, size_t);
+    size_t (*round_large)(const SizingParams&, size_t);
+};
+
+// specialized functions if both divisors are in the grid, runtime ones otherwise
+const SizingFuncs* get_sizing_funcs(size_t kMinBlockSize, size_t kRoundLarge);
+
+}  // namespace AllocatorSim
+}  // namespace cuda
+}  // namespace c10
+
+#endif  // ALLOCATOR_SIZING_H
@@ -0,0 +1,48 @@
+/**
+ * Windows of a block trace.
+ * A slice keeps the blocks allocated in an op_id window. The blocks live at
+ * the window start are allocated first by a prologue, in their malloc order,
+ * so the window replays on top of the same live memory (but not the same
+ * fragmentation, the cached free blocks of the full replay are not rebuilt).
+ * The slice is renumbered from op_id 0 and is a trace on its own.
+*/
+#ifndef ALLOCATOR_SLICE_H
+#define ALLOCATOR_SLICE_H
+
+#include "allocator_utils.h"
+
+namespace c10 {
+namespace cuda {
+namespace AllocatorSim {
+
+struct SliceInfo {
+    size_t num_prologue_blocks = 0;     // live at the window start
+    size_t num_window_blocks = 0;       // allocated in the window
+    size_t num_live_blocks = 0;         // still live at the window end, freed after it
+    op_id_t window_start = 0;           // op_id of the window start in the slice
+};
+
+class traceSlicer {
+private:
+    const trace_t& blocks;
+    // op_id of the first malloc of each iteration
+    std::vector<op_id_t> iteration_starts;
+
+public:
+    // the iterations are split by the period of the malloc sizes, as compressedTrace::encode does
+    explicit traceSlicer(const trace_t& blocks);
+
+    size_t get_num_iterations() const;
+
+    // [start, end) of the iterations [first, last), the end of the last iteration is unbounded
+    std::pair<op_id_t, op_id_t> get_iteration_window(size_t first, size_t last) const;
+
+    // the frees at or after end follow the window in free order
+    SliceInfo slice(op_id_t start, op_id_t end, trace_t& out) const;
+};
+
+}  // namespace AllocatorSim
+}  // namespace cuda
+}  // namespace c10
+
+#endif  // ALLOCATOR_SLICE_H
@@ -0,0 +1,61 @@
+/**
+ * Importer of PyTorch memory snapshots.
+ * torch.cuda.memory._record_memory_history() records the allocator actions
+ * that torch.cuda.memory._snapshot() returns in "device_traces"; the JSON dump
+ * of the snapshot is read here (a pickle from _dump_snapshot() is converted
+ * with json.dump(pickle.load(f), out)). The file is mapped and scanned once,
+ * the frames and the segments are skipped, only the live blocks are held.
+ * Every alloc, free and empty_cache gets the next op_id, as collect_trace()
+ * would number them.
+*/
+#ifndef ALLOCATOR_SNAPSHOT_H
+#define ALLOCATOR_SNAPSHOT_H
+
+#include "allocator_replay.h"
+#include "allocator_trace_file.h"
+
+#include <functional>
+
+namespace c10 {
+namespace cuda {
+namespace AllocatorSim {
+
+class snapshotImporter {
+private:
+    int device;
+
+    size_t num_entries = 0;             // trace entries of the device
+    size_t num_unmatched_frees = 0;     // frees of blocks allocated before the recording
+    size_t num_segment_events = 0;
+    std::set<int64_t> streams;
+
+public:
+    explicit snapshotImporter(int device = 0);
+
+    // on_block when a block is freed (free_completed), the blocks live at the end are
+    // freed at one last op_id; on_api for an explicit empty_cache action only,
+    // false with the reason in error if the file is not a snapshot or the device
+    // has several streams, some blocks may have been passed to on_block then
+    bool import(const std::string& filename,
+                const std::function<void(const TraceBlock&)>& on_block,
+                const std::function<void(op_id_t, AllocatorEventType_t)>& on_api,
+                std::string& error);
+
+    size_t get_num_entries() const;
+
+    size_t get_num_unmatched_frees() const;
+
+    size_t get_num_segment_events() const;
+
+    // streams of the device entries, import() rejects more than one
+    size_t get_num_streams() const;
+
+    // true if filename is a JSON object
+    static bool is_snapshot_file(const std::string& filename);
+};
+
+}  // namespace AllocatorSim
+}  // namespace cuda
+}  // namespace c10
+
+#endif  // ALLOCATOR_SNAPSHOT_H
@@ -0,0 +1,99 @@
+/**
+ * Steady-state detection of a replay.
+ * Training traces repeat the same events every iteration and the pools stop
+ * changing after a few of them. Once the simulator state at a period boundary
+ * equals the state one period earlier, the following repeated periods replay
+ * the same way, so the replay jumps over them and keeps the same peaks.
+*/
+#ifndef ALLOCATOR_STEADY_H
+#define ALLOCATOR_STEADY_H
+
+#include "allocator_simulator.h"
+#include "allocator_replay.h"
+
+#include <functional>
+
+namespace c10 {
+namespace cuda {
+namespace AllocatorSim {
+
+// periodic structure of a compiled trace
+class steadyState {
+private:
+    size_t period = 0;              // events per period, 0 if the trace is not periodic
+    size_t origin = 0;              // index of the first period boundary
+    size_t num_events = 0;
+    // sorted, the events i >= origin + period unlike the event i - period
+    std::vector<size_t> mismatches;
+
+private:
+    static bool is_repeated(const std::vector<ReplayEvent>& events,
+                            const std::vector<ReplaySlot>& slots, size_t i, size_t j);
+
+public:
+    // period_hint: events per iteration if known, otherwise found from the malloc sizes
+    void analyze(const std::vector<ReplayEvent>& events, const std::vector<ReplaySlot>& slots,
+                 size_t origin = 0, size_t period_hint = 0);
+
+    void clear();
+
+    bool is_periodic() const;
+
+    bool is_boundary(size_t i) const;
+
+    size_t get_period() const;
+
+    // the last boundary up to which the events from boundary i repeat the previous period
+    size_t get_repeated_end(size_t i) const;
+};
+
+// the live blocks and the state of one replay at the boundaries of a steadyState
+class steadyStateReplay {
+private:
+    const steadyState& steady;
+    const std::vector<ReplayEvent>& events;
+    const std::vector<ReplaySlot>& slots;
+
+    std::vector<uint32_t> live_slots;
+    std::vector<uint32_t> live_index;   // position in live_slots of each slot
+
+    std::vector<uint64_t> state;
+    std::vector<uint64_t> prev_state;
+    size_t prev_boundary = std::numeric_limits<size_t>::max();
+    AllocatorOpCounts prev_op_counts;
+
+    size_t num_skipped_events = 0;
+    // the calls the skipped periods would have made, as many as in the period before
+    AllocatorOpCounts skipped_op_counts;
+
+private:
+    // the state at boundary i, the blocks freed from until on are compared by their slot
+    void take_state(std::vector<uint64_t>& state, size_t i, size_t until,
+                    const allocatorSim& sim, const std::function<Block*&(uint32_t)>& block_of);
+
+    // from boundary i to end, false if a live block has no slot there
+    bool move_live_blocks(size_t i, size_t end, const std::function<Block*&(uint32_t)>& block_of);
+
+public:
+    steadyStateReplay(const steadyState& steady,
+                      const std::vector<ReplayEvent>& events,
+                      const std::vector<ReplaySlot>& slots);
+
+    void on_malloc(uint32_t slot);
+
+    void on_free(uint32_t slot);
+
+    // at boundary i, returns the event where the replay goes on,
+    // block_of(slot) is the block of a live slot, moved to its slot in the skipped-to period
+    size_t on_boundary(size_t i, const allocatorSim& sim, const std::function<Block*&(uint32_t)>& block_of);
+
+    size_t get_num_skipped_events() const;
+
+    const AllocatorOpCounts& get_skipped_op_counts() const;
+};
+
+}  // namespace AllocatorSim
+}  // namespace cuda
+}  // namespace c10
+
+#endif  // ALLOCATOR_STEADY_H
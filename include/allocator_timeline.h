@@ -0,0 +1,61 @@
+/**
+ * Timeline exporter of the simulator.
+ * Streams segment and block events in Chrome Trace Event JSON format
+ * (chrome://tracing, ui.perfetto.dev) with op ids as timestamps.
+*/
+#ifndef ALLOCATOR_TIMELINE_H
+#define ALLOCATOR_TIMELINE_H
+
+#include "allocator_utils.h"
+
+#include <fstream>
+
+namespace c10 {
+namespace cuda {
+namespace AllocatorSim {
+
+class allocatorTimeline {
+private:
+    std::ofstream output;
+    std::vector<char> buffer;
+    bool first_event = true;
+    size_t num_events = 0;
+
+private:
+    // write the separator and the common fields of an event
+    std::ostream& begin_event(const char* phase, const char* category,
+                              const char* name, op_id_t op_id);
+
+    void end_event();
+
+public:
+    explicit allocatorTimeline(const std::string& filename);
+
+    ~allocatorTimeline();
+
+    bool is_open() const;
+
+    void close();
+
+    size_t get_num_events() const;
+
+    void segment_create(op_id_t op_id, uint64_t ptr, size_t size, bool is_small);
+
+    void segment_release(op_id_t op_id, uint64_t ptr, size_t size);
+
+    void block_allocate(op_id_t op_id, uint64_t ptr, size_t size, size_t orig_size);
+
+    void block_free(op_id_t op_id, uint64_t ptr, size_t size);
+
+    void block_split(op_id_t op_id, uint64_t ptr, size_t size, size_t remaining_size);
+
+    void block_merge(op_id_t op_id, uint64_t ptr, size_t size, size_t subsumed_size);
+
+    void memory_counters(op_id_t op_id, size_t allocated_bytes, size_t reserved_bytes);
+};
+
+}  // namespace AllocatorSim
+}  // namespace cuda
+}  // namespace c10
+
+#endif  // ALLOCATOR_TIMELINE_H
@@ -0,0 +1,179 @@
+/**
+ * Fixed-memory time series of allocator states.
+ * Keeps a ring buffer of the recent samples and multi-resolution downsampled
+ * windows (min/max/last) that cover the whole run.
+*/
+#ifndef ALLOCATOR_TIMESERIES_H
+#define ALLOCATOR_TIMESERIES_H
+
+#include "allocator_utils.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace c10 {
+namespace cuda {
+namespace AllocatorSim {
+
+template <typename T>
+class RingBuffer {
+private:
+    std::vector<T> buffer;
+    size_t head = 0;    // index of the oldest element
+    size_t count = 0;
+
+public:
+    explicit RingBuffer(size_t capacity) : buffer(capacity) {}
+
+    void push(const T& item) {
+        if (count < buffer.size()) {
+            buffer[(head + count) % buffer.size()] = item;
+            count++;
+        } else {
+            buffer[head] = item;
+            head = (head + 1) % buffer.size();
+        }
+    }
+
+    // 0 is the oldest element
+    const T& at(size_t index) const {
+        return buffer[(head + index) % buffer.size()];
+    }
+
+    const T& back() const {
+        return at(count - 1);
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    size_t capacity() const {
+        return buffer.size();
+    }
+
+    bool full() const {
+        return count == buffer.size();
+    }
+
+    void clear() {
+        head = 0;
+        count = 0;
+    }
+};
+
+struct SeriesSample {
+    op_id_t op_id;
+    int64_t reserved;
+    int64_t allocated;
+    int64_t segments;
+    float fragmentation;
+
+    SeriesSample() = default;
+
+    SeriesSample(op_id_t op_id, int64_t reserved, int64_t allocated,
+                 int64_t segments, float fragmentation)
+        : op_id(op_id), reserved(reserved), allocated(allocated),
+        segments(segments), fragmentation(fragmentation) {}
+};
+
+template <typename T>
+struct SeriesAggregate {
+    T min;
+    T max;
+    T last;
+
+    void init(T value) {
+        min = max = last = value;
+    }
+
+    void add(T value) {
+        min = std::min(min, value);
+        max = std::max(max, value);
+        last = value;
+    }
+
+    // other follows this aggregate in time
+    void merge(const SeriesAggregate& other) {
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+        last = other.last;
+    }
+};
+
+struct SeriesWindow {
+    op_id_t first_op_id;
+    op_id_t last_op_id;
+    size_t num_samples = 0;
+
+    SeriesAggregate<int64_t> reserved;
+    SeriesAggregate<int64_t> allocated;
+    SeriesAggregate<int64_t> segments;
+    SeriesAggregate<float> fragmentation;
+
+    void add(const SeriesSample& sample);
+
+    void merge(const SeriesWindow& other);
+};
+
+class allocatorTimeSeries {
+private:
+    struct Level {
+        size_t window_samples;
+        RingBuffer<SeriesWindow> windows;
+        SeriesWindow pending;
+
+        Level(size_t window_samples, size_t capacity)
+            : window_samples(window_samples), windows(capacity) {}
+    };
+
+    RingBuffer<SeriesSample> recent;
+
+    // finer levels are rings of recent windows
+    std::vector<Level> levels;
+
+    // the coarsest level covers the whole run, it halves its resolution when full
+    size_t top_window_samples;
+    size_t top_capacity;
+    std::vector<SeriesWindow> top_windows;
+    SeriesWindow top_pending;
+
+    size_t num_samples = 0;
+    op_id_t first_op_id = 0;
+
+private:
+    void compact_top();
+
+    // downsample windows to at least resolution samples per window
+    static std::vector<SeriesWindow> coarsen(const std::vector<SeriesWindow>& windows,
+                                             size_t resolution);
+
+public:
+    allocatorTimeSeries(size_t recent_capacity = 4096,
+                        size_t num_levels = 3,
+                        size_t base_window = 64,
+                        size_t level_factor = 16,
+                        size_t level_capacity = 1024);
+
+    void record(const SeriesSample& sample);
+
+    // the curve between [begin, end] with resolution samples per window,
+    // served from the finest data that still covers the range
+    std::vector<SeriesWindow> query(size_t resolution,
+                                    op_id_t begin = 0,
+                                    op_id_t end = std::numeric_limits<op_id_t>::max()) const;
+
+    const RingBuffer<SeriesSample>& get_recent() const;
+
+    size_t get_num_samples() const;
+
+    void clear();
+
+    void dump(const std::string& filename, size_t resolution) const;
+};
+
+}  // namespace AllocatorSim
+}  // namespace cuda
+}  // namespace c10
+
+#endif  // ALLOCATOR_TIMESERIES_H
@@ -0,0 +1,189 @@
+/**
+ * Block trace files.
+ * The binary format is a fixed header, one record per block in malloc order:
+ * varints of the malloc op_id delta, the lifetime and the index of the size,
+ * then the dictionary of the distinct block sizes. The writer streams the
+ * records and fills in the header last; the reader maps the file and decodes
+ * the records in place while iterating.
+ * Text traces, one "malloc_op_id free_op_id size" line per block, are parsed
+ * from the mapped file in newline-aligned chunks on several threads.
+*/
+#ifndef ALLOCATOR_TRACE_FILE_H
+#define ALLOCATOR_TRACE_FILE_H
+
+#include "allocator_utils.h"
+
+#include <fstream>
+#include <iterator>
+
+namespace c10 {
+namespace cuda {
+namespace AllocatorSim {
+
+struct TraceBlock {
+    op_id_t malloc_op_id;
+    op_id_t free_op_id;
+    size_t size;
+};
+
+// read-only mapping of a whole file
+class mappedFile {
+private:
+    int fd = -1;
+    const char* data = nullptr;
+    size_t length = 0;
+
+public:
+    explicit mappedFile(const std::string& filename);
+
+    ~mappedFile();
+
+    mappedFile(const mappedFile&) = delete;
+
+    mappedFile& operator=(const mappedFile&) = delete;
+
+    // false if the file cannot be opened or is empty
+    bool is_open() const;
+
+    const char* get_data() const;
+
+    size_t get_length() const;
+};
+
+// blocks of a text trace in file order, num_threads = 0: one per hardware thread,
+// false with the offending line in error if a line has less than three numbers
+bool load_text_trace(const std::string& filename, std::vector<TraceBlock>& blocks,
+                     std::string& error, size_t num_threads = 0);
+
+// text trace lines written through a buffer, for traces too large to hold
+class textTraceWriter {
+private:
+    std::ofstream output;
+    std::vector<char> buffer;
+    size_t used = 0;
+
+    void flush();
+
+public:
+    explicit textTraceWriter(const std::string& filename);
+
+    ~textTraceWriter();
+
+    bool is_open() const;
+
+    void add(op_id_t malloc_op_id, op_id_t free_op_id, size_t size);
+
+    // false if a write failed
+    bool close();
+};
+
+// binary trace records written through a buffer, only the size dictionary is held,
+// the header is written by close() so an unfinished file has no magic
+class binaryTraceWriter {
+private:
+    std::ofstream output;
+    std::vector<uint8_t> buffer;
+    std::vector<size_t> sizes;
+    std::unordered_map<size_t, uint32_t> size_index;
+    uint64_t num_blocks = 0;
+    uint64_t num_records_bytes = 0;
+    op_id_t prev_malloc_op_id = 0;
+
+    void flush();
+
+public:
+    explicit binaryTraceWriter(const std::string& filename);
+
+    ~binaryTraceWriter();
+
+    bool is_open() const;
+
+    // blocks are expected in malloc order, any order is kept
+    void add(op_id_t malloc_op_id, op_id_t free_op_id, size_t size);
+
+    void add(const trace_t& blocks);
+
+    // false if a write failed
+    bool close();
+
+    uint64_t get_num_blocks() const;
+
+    // bytes of the file written by close()
+    size_t get_file_bytes() const;
+};
+
+class binaryTraceReader {
+private:
+    mappedFile file;
+
+    std::vector<size_t> sizes;
+    uint64_t num_blocks = 0;
+    const uint8_t* records = nullptr;
+    const uint8_t* records_end = nullptr;
+    // set by an iterator that stops on a bad record before num_blocks
+    mutable bool truncated = false;
+
+public:
+    class iterator {
+    private:
+        const binaryTraceReader* reader = nullptr;
+        const uint8_t* pos = nullptr;
+        uint64_t remaining = 0;
+        TraceBlock block {0, 0, 0};
+
+        // decodes the next record, remaining is 0 at the end or on a truncated record,
+        // which also marks the reader as not ok()
+        void next();
+
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = TraceBlock;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const TraceBlock*;
+        using reference = const TraceBlock&;
+
+        iterator() = default;
+
+        iterator(const binaryTraceReader* reader, const uint8_t* pos, uint64_t remaining);
+
+        reference operator*() const { return block; }
+
+        pointer operator->() const { return &block; }
+
+        iterator& operator++() {
+            next();
+            return *this;
+        }
+
+        bool operator==(const iterator& other) const { return remaining == other.remaining; }
+
+        bool operator!=(const iterator& other) const { return remaining != other.remaining; }
+    };
+
+public:
+    // is_open() is false if filename is not a binary trace of a known version
+    explicit binaryTraceReader(const std::string& filename);
+
+    bool is_open() const;
+
+    // false if the file is not open or an iteration stopped on a truncated or bad record
+    bool ok() const;
+
+    // blocks of the header, an ok() iteration yields exactly as many
+    uint64_t get_num_blocks() const;
+
+    size_t get_num_sizes() const;
+
+    iterator begin() const;
+
+    iterator end() const;
+
+    // true if filename starts with the magic of binaryTraceWriter
+    static bool is_binary_file(const std::string& filename);
+};
+
+}  // namespace AllocatorSim
+}  // namespace cuda
+}  // namespace c10
+
+#endif  // ALLOCATOR_TRACE_FILE_H
@@ -0,0 +1,126 @@
+/**
+ * Per-thread trace buffers of allocator events.
+ * Each thread appends fixed-size records to its own chunked buffer without
+ * locks, events are ordered by the global op_id and merged when the trace
+ * is processed. Chunks come from a preallocated pool and are recycled on
+ * drain, so the hot path does not allocate in steady state.
+*/
+#ifndef ALLOCATOR_TRACER_H
+#define ALLOCATOR_TRACER_H
+
+#include "allocator_utils.h"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace c10 {
+namespace cuda {
+namespace AllocatorSim {
+
+// 32 bytes, the direction is the sign of size (real frees are not recorded)
+struct TraceEvent {
+    op_id_t op_id;
+    void* ptr;
+    int64_t size;       // > 0: malloc, < 0: free
+    uint64_t callpath;  // id of the malloc callpath, 0 if not profiled
+
+    TraceEvent() = default;
+
+    TraceEvent(op_id_t op_id, void* ptr, int64_t size, uint64_t callpath = 0)
+        : op_id(op_id), ptr(ptr), size(size), callpath(callpath) {}
+};
+
+struct TraceChunk {
+    static const size_t CAPACITY = 4096;
+
+    TraceEvent events[CAPACITY];
+    // number of events visible to the consumer
+    std::atomic<size_t> count{0};
+    std::atomic<TraceChunk*> next{nullptr};
+};
+
+// single producer (the owner thread), single consumer (drain)
+struct ThreadTraceBuffer {
+    TraceChunk* head;   // consumer side
+    TraceChunk* tail;   // producer side
+    size_t read_pos = 0;
+    std::thread::id owner;
+
+    // <callpath id, text> seen by the owner, written by the owner only, under callpath_mutex
+    std::unordered_map<uint64_t, std::string> callpaths;
+    std::mutex callpath_mutex;
+
+    ThreadTraceBuffer(TraceChunk* chunk, std::thread::id owner) : head(chunk), tail(chunk), owner(owner) {}
+
+    ~ThreadTraceBuffer();
+};
+
+class allocatorTracer {
+private:
+    // distinguishes tracers in the thread_local buffer cache, never reused
+    const uint64_t tracer_id;
+
+    // only taken when a thread registers its buffer and when draining
+    std::mutex registry_mutex;
+    std::vector<std::unique_ptr<ThreadTraceBuffer>> buffers;
+
+    // taken once per TraceChunk::CAPACITY events of a thread
+    std::mutex pool_mutex;
+    std::vector<TraceChunk*> chunk_pool;
+    size_t num_chunks = 0;
+    // 0: the pool grows without bound
+    const size_t max_chunks;
+
+    // appends that found no chunk at max_chunks
+    std::atomic<uint64_t> num_dropped{0};
+
+private:
+    // the buffer of the calling thread in the registry, created on its first append
+    ThreadTraceBuffer* register_thread();
+
+    ThreadTraceBuffer* get_thread_buffer();
+
+    // from the pool, the pool grows by a batch of chunks when it runs out,
+    // nullptr if it has max_chunks chunks and none is free
+    TraceChunk* acquire_chunk();
+
+    void release_chunk(TraceChunk* chunk);
+
+    bool append_event(ThreadTraceBuffer* buffer, const TraceEvent& event);
+
+public:
+    // with max_chunks, the events of at most max_chunks chunks wait for drain() and
+    // the appends beyond are dropped, the traced thread is never blocked
+    explicit allocatorTracer(size_t num_preallocated_chunks = 16, size_t max_chunks = 0);
+
+    ~allocatorTracer();
+
+    // lock-free unless this tracer is not in the thread_local cache of the calling thread,
+    // false if the event is dropped at max_chunks
+    bool append(op_id_t op_id, void* ptr, int64_t size);
+
+    // a malloc with its callpath, the text is kept once per callpath and thread,
+    // only the first occurrence takes the (uncontended) lock of the thread buffer
+    bool append(op_id_t op_id, void* ptr, int64_t size, uint64_t callpath, const std::string& text);
+
+    // move all the published events out of the buffers, sorted by op_id
+    std::vector<TraceEvent> drain();
+
+    // <callpath id, text> of the callpaths appended by all the threads so far
+    std::unordered_map<uint64_t, std::string> get_callpaths();
+
+    size_t get_num_threads();
+
+    // allocated chunks, in use or pooled
+    size_t get_num_chunks();
+
+    uint64_t get_num_dropped() const;
+};
+
+}  // namespace AllocatorSim
+}  // namespace cuda
+}  // namespace c10
+
+#endif  // ALLOCATOR_TRACER_H
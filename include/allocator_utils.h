@@ -55,6 +55,7 @@ struct Block {
     int device; // gpu
     int stream; // allocation stream
     size_t size; // block size in bytes
+    size_t requested_size; // memory originally requested
     BlockPool* pool; // owning memory pool
     uint64_t ptr; // memory address
     bool allocated; // in-use flag
@@ -73,6 +74,7 @@ struct Block {
         : device(device),
             stream(stream),
             size(size),
+            requested_size(0),
             pool(pool),
             ptr(ptr),
             allocated(0),
@@ -86,6 +88,7 @@ struct Block {
         : device(device),
             stream(stream),
             size(size),
+            requested_size(0),
             pool(nullptr),
             ptr(0),
             allocated(0),
@@ -99,6 +102,7 @@ struct Block {
         : device(device),
             stream(stream),
             size(size),
+            requested_size(0),
             pool(nullptr),
             ptr(ptr),
             allocated(0),
@@ -176,6 +180,8 @@ std::string format_size(size_t size);
 // get and increase global op_id
 op_id_t get_global_op_id();
 void increase_global_op_id();
+// atomically take the current op_id and increase it, safe across threads
+op_id_t next_global_op_id();
 
 
 /******************************************************************************/
@@ -213,7 +219,16 @@ typedef enum SimControlMode{
     TRACE_DUMPPING = 6,
     CONFIG_OPTIMIZATION = 7,
     GROUP_OPTIMIZATION = 8,
-    NUMS_OF_SIM_CONTROL_MODE = 9
+    MEMORY_PLANNING = 9,
+    TIMELINE_EXPORTING = 10,
+    PEAK_ATTRIBUTION = 11,
+    ONLINE_SIMULATION = 12,
+    BACKGROUND_SEARCH = 13,
+    TRACE_COMPRESSION = 14,
+    STEADY_STATE_DETECTION = 15,
+    SENSITIVITY_ANALYSIS = 16,
+    CONFIG_STORE = 17,
+    NUMS_OF_SIM_CONTROL_MODE = 18
 }SimControlMode_t;
 
 void set_sim_control_mode(SimControlMode_t mode, bool enable);
@@ -297,6 +312,76 @@ struct SimulatorModeController{
     static bool enable_group_optimization;
     static bool is_group_optimization();
     static void set_group_optimization(bool optimization);
+
+    /*
+    export a static memory plan of one iteration and validate it
+    against the following iterations
+    */
+    static bool enable_memory_planning;
+    static bool is_memory_planning();
+    static void set_memory_planning(bool planning);
+
+    /*
+    export the simulated blocks and segments as a Chrome trace timeline
+    */
+    static bool enable_timeline_exporting;
+    static bool is_timeline_exporting();
+    static void set_timeline_exporting(bool exporting);
+
+    /*
+    attribute the live blocks at the memory peaks to their callpaths
+    */
+    static bool enable_peak_attribution;
+    static bool is_peak_attribution();
+    static void set_peak_attribution(bool attribution);
+
+    /*
+    advance simulators with the traced events in a background thread
+    instead of replaying the whole trace at the end of profiling
+    */
+    static bool enable_online_simulation;
+    static bool is_online_simulation();
+    static void set_online_simulation(bool online);
+
+    /*
+    search the configs on a thread pool while training goes on
+    and apply the result at a later iteration boundary
+    */
+    static bool enable_background_search;
+    static bool is_background_search();
+    static void set_background_search(bool background);
+
+    /*
+    keep the processed trace as one iteration template plus per-iteration deltas
+    and dump it in the compressed format
+    */
+    static bool enable_trace_compression;
+    static bool is_trace_compression();
+    static void set_trace_compression(bool compression);
+
+    /*
+    skip the repeated periods of a replay once the simulator state is a fixed point
+    at the period boundaries, the scores are the same as a full replay
+    */
+    static bool enable_steady_state_detection;
+    static bool is_steady_state_detection();
+    static void set_steady_state_detection(bool detection);
+
+    /*
+    sweep each config and the group difference around the current configs,
+    the others held fixed, report the reserved bytes and segments per value
+    */
+    static bool enable_sensitivity_analysis;
+    static bool is_sensitivity_analysis();
+    static void set_sensitivity_analysis(bool analysis);
+
+    /*
+    reuse the stored configs of the same workload instead of searching, warm-start
+    the search around the configs of a similar one, and store the searched configs
+    */
+    static bool enable_config_store;
+    static bool is_config_store();
+    static void set_config_store(bool store);
 };
 
 }  // namespace sim_control
@@ -0,0 +1,133 @@
+/**
+ * Synthetic workload traces.
+ * Generates block traces of common training and inference patterns for
+ * benchmarking the simulator: transformer activation stacks, CNN layers,
+ * optimizer states, KV-cache growth and random lifetimes. The trace only
+ * depends on the config, the seed included, so a benchmark can be rerun on
+ * the same trace without storing it.
+*/
+#ifndef ALLOCATOR_WORKLOAD_H
+#define ALLOCATOR_WORKLOAD_H
+
+#include "allocator_trace_file.h"
+
+#include <deque>
+#include <functional>
+#include <queue>
+
+namespace c10 {
+namespace cuda {
+namespace AllocatorSim {
+
+typedef enum WorkloadPattern {
+    WORKLOAD_TRANSFORMER = 0,   // saved activations per layer, freed in reverse by backward
+    WORKLOAD_CNN = 1,           // conv activations and workspaces, downsampled every quarter
+    WORKLOAD_OPTIMIZER = 2,     // params and Adam states kept, grads and step temporaries
+    WORKLOAD_KV_CACHE = 3,      // decode steps growing a KV block per request and layer
+    WORKLOAD_RANDOM = 4,        // log-uniform sizes, geometric lifetimes
+    NUMS_OF_WORKLOAD = 5
+} WorkloadPattern_t;
+
+struct WorkloadConfig {
+    WorkloadPattern_t pattern = WORKLOAD_TRANSFORMER;
+    uint64_t seed = 0;
+    size_t num_iterations = 10;     // training steps, decode steps for the KV cache
+    uint64_t max_events = 0;        // mallocs and frees, 0 for no limit, the live blocks are freed after
+
+    size_t num_layers = 12;
+    size_t batch_size = 8;          // concurrent requests for the KV cache
+    size_t seq_len = 512;           // image side for the CNN, max context for the KV cache
+    size_t hidden_size = 768;       // base channels for the CNN
+    size_t element_size = 2;
+    double seq_jitter = 0.0;        // the sequence of an iteration is up to this fraction shorter
+
+    // WORKLOAD_RANDOM
+    size_t blocks_per_iteration = 1000;
+    size_t min_size = 512;
+    size_t max_size = 64 << 20;
+    double mean_lifetime = 50.0;    // in mallocs, capped at blocks_per_iteration
+};
+
+class workloadGenerator {
+private:
+    struct GeneratedBlock {
+        op_id_t malloc_op_id;
+        op_id_t free_op_id;
+        size_t size;
+    };
+
+    const WorkloadConfig config;
+    uint64_t rng_state;
+
+    op_id_t op_id = 0;
+    bool stopped = false;           // max_events is reached
+
+    // blocks of the previous and the current iteration, by handle
+    std::deque<GeneratedBlock> window;
+    uint64_t first_handle = 0;
+    uint64_t iteration_handle = 0;  // first handle of the current iteration
+    // blocks not freed by the end of the iteration after theirs, live until the end
+    std::vector<GeneratedBlock> kept_blocks;
+
+    std::function<void(const TraceBlock&)> on_block;
+
+    // WORKLOAD_KV_CACHE, one per slot of batch_size
+    struct KvRequest {
+        size_t remaining = 0;       // decode steps left, 0 for a free slot
+        size_t length = 0;          // tokens in the cache
+        std::vector<uint64_t> layers;
+    };
+    std::vector<KvRequest> kv_requests;
+
+    // WORKLOAD_RANDOM, <malloc count, handle> of the blocks to free
+    std::priority_queue<std::pair<uint64_t, uint64_t>, std::vector<std::pair<uint64_t, uint64_t>>,
+                        std::greater<std::pair<uint64_t, uint64_t>>> pending_frees;
+    uint64_t num_mallocs = 0;
+
+    static constexpr uint64_t NO_BLOCK = std::numeric_limits<uint64_t>::max();
+
+private:
+    uint64_t next_random();
+
+    // uniform in [lo, hi]
+    size_t uniform(size_t lo, size_t hi);
+
+    double uniform_real();
+
+    // a handle, NO_BLOCK once stopped
+    uint64_t malloc_block(size_t size);
+
+    // a block of an earlier emitted iteration is kept instead
+    void free_block(uint64_t handle);
+
+    // emit the blocks below end_handle, the ones not freed yet are kept
+    void emit_window(uint64_t end_handle);
+
+    void transformer_iteration();
+
+    void cnn_iteration();
+
+    void optimizer_iteration(size_t iter);
+
+    void kv_cache_iteration();
+
+    void random_iteration();
+
+    // the sequence length of an iteration with seq_jitter
+    size_t jittered_seq_len();
+
+public:
+    explicit workloadGenerator(const WorkloadConfig& config);
+
+    // on_block in malloc order, the blocks still live at the end follow with their own
+    // free op_ids after the last event, returns the number of events
+    uint64_t generate(const std::function<void(const TraceBlock&)>& on_block);
+
+    static bool parse_pattern(const std::string& name, WorkloadPattern_t& pattern);
+};
+
+}  // namespace AllocatorSim
+}  // namespace cuda
+}  // namespace c10
+
+#endif  // ALLOCATOR_WORKLOAD_H
@@ -0,0 +1,337 @@
+#include "allocator_compress.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+namespace c10 {
+namespace cuda {
+namespace AllocatorSim {
+
+namespace {
+    const std::string COMPRESSED_TRACE_HEADER = "# allocatorsim compressed trace v1";
+
+    // a period is accepted when this fraction of the second half of the sizes repeats
+    const double PERIOD_MATCH_RATIO = 0.9;
+    // sizes at the end of the trace compared before checking a whole period
+    const size_t PERIOD_PROBE_LENGTH = 16;
+    // sizes of the second half compared before counting them all
+    const size_t PERIOD_SAMPLES = 64;
+    // the whole counts compare at most this many sizes per size (and at least
+    // PERIOD_MIN_BUDGET sizes) before giving up
+    const size_t PERIOD_CHECK_BUDGET = 64;
+    const size_t PERIOD_MIN_BUDGET = 1 << 22;
+
+    // z[p]: how many sizes match the ones p before them, counted back from the end,
+    // i.e. the Z-array of the reversed sizes, O(n)
+    std::vector<size_t> reversed_z_array(const std::vector<size_t>& sizes) {
+        auto n = sizes.size();
+        auto at = [&sizes, n](size_t i) { return sizes[n - 1 - i]; };
+        std::vector<size_t> z(n, 0);
+        if (n > 0) {
+            z[0] = n;
+        }
+        size_t l = 0, r = 0;
+        for (size_t i = 1; i < n; i++) {
+            if (i < r) {
+                z[i] = std::min(r - i, z[i - l]);
+            }
+            while (i + z[i] < n && at(z[i]) == at(i + z[i])) {
+                z[i]++;
+            }
+            if (i + z[i] > r) {
+                l = i;
+                r = i + z[i];
+            }
+        }
+        return z;
+    }
+
+    void hash_combine(size_t& seed, uint64_t value) {
+        seed ^= std::hash<uint64_t>()(value) + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+    }
+
+    size_t hash_records(const std::vector<TraceRecord>& records) {
+        size_t seed = records.size();
+        for (auto& r : records) {
+            hash_combine(seed, r.malloc_offset);
+            hash_combine(seed, r.lifetime);
+            hash_combine(seed, r.size);
+        }
+        return seed;
+    }
+}   // anonymous namespace for variables
+
+void compressedTrace::encode_iterations(const std::vector<op_id_t>& starts,
+                                        const std::vector<std::vector<TraceRecord>>& records) {
+    clear();
+    if (records.empty()) {
+        return;
+    }
+
+    // the most frequent iteration is the template
+    std::unordered_map<size_t, size_t> counts;
+    size_t best = 0;
+    size_t best_count = 0;
+    for (size_t i = 0; i < records.size(); i++) {
+        auto count = ++counts[hash_records(records[i])];
+        if (count > best_count) {
+            best = i;
+            best_count = count;
+        }
+    }
+    template_records = records[best];
+
+    iterations.reserve(records.size());
+    for (size_t i = 0; i < records.size(); i++) {
+        IterationDelta delta;
+        delta.start_op_id = starts[i];
+        delta.num_records = static_cast<uint32_t>(records[i].size());
+        for (size_t j = 0; j < records[i].size(); j++) {
+            if (j >= template_records.size() || records[i][j] != template_records[j]) {
+                delta.patches.push_back(TracePatch{static_cast<uint32_t>(j), records[i][j]});
+            }
+        }
+        iterations.push_back(std::move(delta));
+    }
+}
+
+void compressedTrace::encode(const trace_t& blocks, const std::vector<op_id_t>& boundaries) {
+    // iteration i holds the blocks allocated in [starts[i], starts[i + 1])
+    std::vector<op_id_t> starts {0};
+    starts.insert(starts.end(), boundaries.begin(), boundaries.end());
+    std::vector<std::vector<TraceRecord>> records(starts.size());
+    for (auto& t : blocks) {
+        auto i = std::upper_bound(starts.begin(), starts.end(), t.first) - starts.begin() - 1;
+        records[i].emplace_back(t.first - starts[i], t.second.first - t.first, t.second.second);
+    }
+    encode_iterations(starts, records);
+}
+
+void compressedTrace::encode(const trace_t& blocks) {
+    std::vector<size_t> sizes;
+    sizes.reserve(blocks.size());
+    for (auto& t : blocks) {
+        sizes.push_back(t.second.second);
+    }
+    auto period = std::max<size_t>(detect_period(sizes), 1);
+
+    // every period mallocs start an iteration at the op_id of its first malloc
+    std::vector<op_id_t> starts;
+    std::vector<std::vector<TraceRecord>> records;
+    size_t index = 0;
+    for (auto& t : blocks) {
+        if (index % period == 0) {
+            starts.push_back(t.first);
+            records.emplace_back();
+        }
+        records.back().emplace_back(t.first - starts.back(), t.second.first - t.first, t.second.second);
+        index++;
+    }
+    encode_iterations(starts, records);
+}
+
+size_t compressedTrace::detect_period(const std::vector<size_t>& sizes) {
+    auto n = sizes.size();
+    if (n < 2 * PERIOD_PROBE_LENGTH) {
+        return n;
+    }
+    auto z = reversed_z_array(sizes);
+    size_t budget = std::max(PERIOD_CHECK_BUDGET * n, PERIOD_MIN_BUDGET);
+    for (size_t p = 1; p <= n / 2; p++) {
+        // the end of the trace is past the warmup iteration
+        if (z[p] < PERIOD_PROBE_LENGTH) {
+            continue;
+        }
+        size_t begin = std::max(p, n / 2);
+        size_t window = n - begin;
+        size_t max_mismatches = window - static_cast<size_t>(std::ceil(PERIOD_MATCH_RATIO * window));
+        // the run at the end is known to match, only the sizes before it are compared
+        size_t end = n - std::min(z[p], window);
+        if (end - begin <= max_mismatches) {
+            return p;
+        }
+
+        // a few evenly spaced sizes reject most candidates, e.g. every p of a constant tail
+        size_t stride = std::max<size_t>((end - begin) / PERIOD_SAMPLES, 1);
+        size_t num_samples = 0;
+        size_t sample_mismatches = 0;
+        for (size_t i = begin; i < end; i += stride) {
+            sample_mismatches += (sizes[i] != sizes[i - p]);
+            num_samples++;
+        }
+        // more than three times the allowed mismatch rate, and 1/8 for the sampling error
+        size_t compared = end - begin;
+        if (8 * sample_mismatches * compared > (24 * max_mismatches + compared) * num_samples) {
+            continue;
+        }
+
+        // stops at the first mismatch too many, the budget bounds the candidates that pass the samples
+        size_t mismatches = 0;
+        size_t i = begin;
+        for (; i < end && mismatches <= max_mismatches; i++) {
+            mismatches += (sizes[i] != sizes[i - p]);
+        }
+        if (mismatches <= max_mismatches) {
+            return p;
+        }
+        budget -= std::min(budget, i - begin);
+        if (budget == 0) {
+            break;
+        }
+    }
+    return n;
+}
+
+void compressedTrace::for_each_block(const std::function<void(op_id_t, op_id_t, size_t)>& fn) const {
+    for (auto& it : iterations) {
+        size_t p = 0;
+        for (uint32_t j = 0; j < it.num_records; j++) {
+            const TraceRecord* r;
+            if (p < it.patches.size() && it.patches[p].index == j) {
+                r = &it.patches[p++].record;
+            } else {
+                r = &template_records[j];
+            }
+            auto malloc_op_id = it.start_op_id + r->malloc_offset;
+            fn(malloc_op_id, malloc_op_id + r->lifetime, r->size);
+        }
+    }
+}
+
+void compressedTrace::decode(trace_t& blocks) const {
+    for_each_block([&blocks](op_id_t malloc_op_id, op_id_t free_op_id, size_t size) {
+        blocks.emplace(malloc_op_id, std::make_pair(free_op_id, size));
+    });
+}
+
+void compressedTrace::clear() {
+    template_records.clear();
+    iterations.clear();
+}
+
+bool compressedTrace::empty() const {
+    return iterations.empty();
+}
+
+void compressedTrace::dump(const std::string& filename) const {
+    std::ofstream output(filename);
+    output << COMPRESSED_TRACE_HEADER << std::endl;
+    output << "template " << template_records.size() << std::endl;
+    for (auto& r : template_records) {
+        output << r.malloc_offset << " " << r.lifetime << " " << r.size << std::endl;
+    }
+    output << "iterations " << iterations.size() << std::endl;
+    for (auto& it : iterations) {
+        output << it.start_op_id << " " << it.num_records << " " << it.patches.size() << std::endl;
+        for (auto& patch : it.patches) {
+            output << patch.index << " " << patch.record.malloc_offset << " "
+                   << patch.record.lifetime << " " << patch.record.size << std::endl;
+        }
+    }
+    output.close();
+}
+
+bool compressedTrace::load(const std::string& filename, std::string& error) {
+    clear();
+    std::ifstream input(filename);
+    if (!input) {
+        error = "cannot read " + filename;
+        return false;
+    }
+    auto fail = [&](const std::string& reason) {
+        clear();
+        error = filename + ": " + reason;
+        return false;
+    };
+    std::string line, tag;
+    if (!std::getline(input, line) || line != COMPRESSED_TRACE_HEADER) {
+        return fail("not a compressed trace");
+    }
+
+    // the counts are not trusted for reserve(), a record is read before it is stored
+    size_t num_records = 0;
+    if (!(input >> tag >> num_records) || tag != "template") {
+        return fail("bad template header");
+    }
+    for (size_t i = 0; i < num_records; i++) {
+        TraceRecord r;
+        if (!(input >> r.malloc_offset >> r.lifetime >> r.size)) {
+            return fail("template record " + std::to_string(i) + " of " + std::to_string(num_records) + " is missing");
+        }
+        template_records.push_back(r);
+    }
+
+    size_t num_iterations = 0;
+    if (!(input >> tag >> num_iterations) || tag != "iterations") {
+        return fail("bad iterations header");
+    }
+    for (size_t i = 0; i < num_iterations; i++) {
+        IterationDelta it;
+        size_t num_patches = 0;
+        if (!(input >> it.start_op_id >> it.num_records >> num_patches)) {
+            return fail("iteration " + std::to_string(i) + " of " + std::to_string(num_iterations) + " is missing");
+        }
+        if (num_patches > it.num_records) {
+            return fail("iteration " + std::to_string(i) + " has more patches than records");
+        }
+        // the patches are in index order, and every record past the template is patched
+        size_t num_extending = 0;
+        for (size_t p = 0; p < num_patches; p++) {
+            TracePatch patch;
+            if (!(input >> patch.index >> patch.record.malloc_offset >> patch.record.lifetime >> patch.record.size)) {
+                return fail("patch " + std::to_string(p) + " of iteration " + std::to_string(i) + " is missing");
+            }
+            if (patch.index >= it.num_records || (!it.patches.empty() && patch.index <= it.patches.back().index)) {
+                return fail("patch " + std::to_string(p) + " of iteration " + std::to_string(i)
+                            + " has a bad index " + std::to_string(patch.index));
+            }
+            num_extending += (patch.index >= template_records.size());
+            it.patches.push_back(patch);
+        }
+        if (it.num_records > template_records.size() && num_extending != it.num_records - template_records.size()) {
+            return fail("iteration " + std::to_string(i) + " has records past the template without a patch");
+        }
+        iterations.push_back(std::move(it));
+    }
+    return true;
+}
+
+bool compressedTrace::is_compressed_file(const std::string& filename) {
+    std::ifstream input(filename);
+    std::string line;
+    return std::getline(input, line) && line == COMPRESSED_TRACE_HEADER;
+}
+
+size_t compressedTrace::get_num_iterations() const {
+    return iterations.size();
+}
+
+size_t compressedTrace::get_num_blocks() const {
+    size_t num_blocks = 0;
+    for (auto& it : iterations) {
+        num_blocks += it.num_records;
+    }
+    return num_blocks;
+}
+
+size_t compressedTrace::get_num_patches() const {
+    size_t num_patches = 0;
+    for (auto& it : iterations) {
+        num_patches += it.patches.size();
+    }
+    return num_patches;
+}
+
+size_t compressedTrace::get_memory_bytes() const {
+    size_t bytes = template_records.capacity() * sizeof(TraceRecord)
+                 + iterations.capacity() * sizeof(IterationDelta);
+    for (auto& it : iterations) {
+        bytes += it.patches.capacity() * sizeof(TracePatch);
+    }
+    return bytes;
+}
+
+}  // namespace AllocatorSim
+}  // namespace cuda
+}  // namespace c10
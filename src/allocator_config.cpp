@@ -25,15 +25,9 @@ std::array<GET_FUNC, CONFIG_NUMS> allocatorConf::get_funcs = {
     get_kLargeBuffer, get_kMinLargeAlloc, get_kRoundLarge
 };
 
-std::array<size_t, GROUP_NUMS> allocatorConf::_GROUPS = {
-    std::numeric_limits<size_t>::max(),
-    std::numeric_limits<size_t>::max(),
-    std::numeric_limits<size_t>::max(),
-    std::numeric_limits<size_t>::max(),
-    std::numeric_limits<size_t>::max()
-};
+std::vector<size_t> allocatorConf::_GROUPS;
 
-std::array<size_t, GROUP_NUMS> allocatorConf::BACKUP_GROUPS = _GROUPS;
+std::vector<size_t> allocatorConf::BACKUP_GROUPS;
 
 size_t allocatorConf::m_max_split_size = std::numeric_limits<size_t>::max();
 
@@ -47,12 +41,38 @@ uint64_t allocatorConf::m_memory_segment_address_start = 1000;
 
 uint64_t allocatorConf::m_memory_segment_address_interval = 1000;
 
+uint64_t allocatorConf::config_version = 0;
+
+uint64_t allocatorConf::get_config_version() {
+    return config_version;
+}
+
+size_t allocatorConf::get_group_size(size_t size) {
+    return get_group_size(_GROUPS, size);
+}
+
+size_t allocatorConf::get_group_size(const std::vector<size_t>& groups, size_t size) {
+    if (groups.empty() || size > groups.back()) {
+        return 0;
+    }
+    // branchless lower bound, the halving only depends on the number of groups
+    const size_t* base = groups.data();
+    size_t n = groups.size();
+    while (n > 1) {
+        size_t half = n / 2;
+        base = (base[half - 1] < size) ? base + half : base;
+        n -= half;
+    }
+    return *base;
+}
+
 size_t allocatorConf::get_kMinBlockSize() {
     return kMinBlockSize;
 }
 
 void allocatorConf::set_kMinBlockSize(size_t size) {
     kMinBlockSize = size;
+    config_version++;
 }
 
 size_t allocatorConf::get_kSmallSize() {
@@ -61,6 +81,7 @@ size_t allocatorConf::get_kSmallSize() {
 
 void allocatorConf::set_kSmallSize(size_t size) {
     kSmallSize = size;
+    config_version++;
 }
 
 size_t allocatorConf::get_kSmallBuffer() {
@@ -69,6 +90,7 @@ size_t allocatorConf::get_kSmallBuffer() {
 
 void allocatorConf::set_kSmallBuffer(size_t size) {
     kSmallBuffer = size;
+    config_version++;
 }
 
 size_t allocatorConf::get_kLargeBuffer() {
@@ -77,6 +99,7 @@ size_t allocatorConf::get_kLargeBuffer() {
 
 void allocatorConf::set_kLargeBuffer(size_t size) {
     kLargeBuffer = size;
+    config_version++;
 }
 
 size_t allocatorConf::get_kMinLargeAlloc() {
@@ -85,6 +108,7 @@ size_t allocatorConf::get_kMinLargeAlloc() {
 
 void allocatorConf::set_kMinLargeAlloc(size_t size) {
     kMinLargeAlloc = size;
+    config_version++;
 }
 
 size_t allocatorConf::get_kRoundLarge() {
@@ -93,6 +117,7 @@ size_t allocatorConf::get_kRoundLarge() {
 
 void allocatorConf::set_kRoundLarge(size_t size) {
     kRoundLarge = size;
+    config_version++;
 }
 
 size_t allocatorConf::get_max_split_size() {
@@ -101,6 +126,7 @@ size_t allocatorConf::get_max_split_size() {
 
 void allocatorConf::set_max_split_size(size_t size) {
     m_max_split_size = size;
+    config_version++;
 }
 
 size_t allocatorConf::get_roundup_power2_divisions() {
@@ -109,6 +135,7 @@ size_t allocatorConf::get_roundup_power2_divisions() {
 
 void allocatorConf::set_roundup_power2_divisions(size_t val) {
     m_roundup_power2_divisions = val;
+    config_version++;
 }
 
 size_t allocatorConf::get_roundup_bypass_threshold() {
@@ -117,6 +144,7 @@ size_t allocatorConf::get_roundup_bypass_threshold() {
 
 void allocatorConf::set_roundup_bypass_threshold(size_t threshold) {
     m_roundup_bypass_threshold = threshold;
+    config_version++;
 }
 
 double allocatorConf::get_garbage_collection_threshold() {
@@ -125,6 +153,7 @@ double allocatorConf::get_garbage_collection_threshold() {
 
 void allocatorConf::set_garbage_collection_threshold(double threshold) {
     m_garbage_collection_threshold = threshold;
+    config_version++;
 }
 
 uint64_t allocatorConf::get_memory_segment_address_start() {
@@ -133,6 +162,7 @@ uint64_t allocatorConf::get_memory_segment_address_start() {
 
 void allocatorConf::set_memory_segment_address_start(uint64_t start) {
     m_memory_segment_address_start = start;
+    config_version++;
 }
 
 uint64_t allocatorConf::get_memory_segment_address_interval() {
@@ -141,6 +171,7 @@ uint64_t allocatorConf::get_memory_segment_address_interval() {
 
 void allocatorConf::set_memory_segment_address_interval(uint64_t interval) {
     m_memory_segment_address_interval = interval;
+    config_version++;
 }
 
 }  // namespace AllocatorSim
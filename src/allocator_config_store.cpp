@@ -0,0 +1,253 @@
+#include "allocator_config_store.h"
+#include "allocator_utils.h"
+#include "utils/hash.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <system_error>
+
+#include <unistd.h>
+
+namespace c10 {
+namespace cuda {
+namespace AllocatorSim {
+
+namespace {
+    const std::array<std::string, CONFIG_NUMS> CONFIG_NAMES {
+        "kMinBlockSize", "kSmallSize", "kSmallBuffer", "kLargeBuffer", "kMinLargeAlloc", "kRoundLarge"
+    };
+    const std::string ENTRY_EXTENSION = ".txt";
+    // hex digits of the mode and objective hash in the file name
+    const size_t KEY_SUFFIX_LENGTH = 16;
+}   // anonymous namespace for variables
+
+WorkloadSignature WorkloadSignature::from_sizes(const std::vector<size_t>& sizes) {
+    WorkloadSignature signature;
+    std::string sequence;
+    for (auto size : sizes) {
+        sequence += std::to_string(size) + ",";
+        signature.size_counts[size]++;
+    }
+    signature.hash = sha256(sequence);
+    return signature;
+}
+
+double WorkloadSignature::similarity(const WorkloadSignature& other) const {
+    if (hash == other.hash) {
+        return 1.0;
+    }
+    // sum of min over sum of max of the counts, both maps are sorted by size
+    double common = 0.0;
+    double total = 0.0;
+    auto a = size_counts.begin();
+    auto b = other.size_counts.begin();
+    while (a != size_counts.end() || b != other.size_counts.end()) {
+        if (b == other.size_counts.end() || (a != size_counts.end() && a->first < b->first)) {
+            total += a->second;
+            a++;
+        } else if (a == size_counts.end() || b->first < a->first) {
+            total += b->second;
+            b++;
+        } else {
+            common += std::min(a->second, b->second);
+            total += std::max(a->second, b->second);
+            a++;
+            b++;
+        }
+    }
+    return total > 0 ? common / total : 0.0;
+}
+
+configStore::configStore(const std::string& directory) : directory(directory) {
+}
+
+std::string configStore::get_filename(const std::string& signature_hash, const std::string& search_mode,
+                                      const std::string& objective) const {
+    auto key = signature_hash + "_" + sha256(search_mode + " " + objective).substr(0, KEY_SUFFIX_LENGTH);
+    return (fs::path(directory) / (key + ENTRY_EXTENSION)).string();
+}
+
+bool configStore::save(const StoredConfigs& entry, std::string& error) const {
+    std::error_code ec;
+    if (!fs::is_directory(directory, ec)) {
+        fs::create_directories(directory, ec);
+        if (ec) {
+            error = "cannot create " + directory + ": " + ec.message();
+            return false;
+        }
+    }
+    // written next to the entry and renamed over it, so a reader never sees half an entry,
+    // the temporary name has no ENTRY_EXTENSION for find() to pick up
+    auto filename = get_filename(entry.signature.hash, entry.search_mode, entry.objective);
+    auto temp_filename = filename + ".tmp" + std::to_string(getpid());
+    std::ofstream out(temp_filename);
+    if (!out) {
+        error = "cannot write " + temp_filename;
+        return false;
+    }
+    out << "version " << VERSION << std::endl;
+    out << "signature " << entry.signature.hash << std::endl;
+    for (size_t i = 0; i < CONFIG_NUMS; i++) {
+        out << CONFIG_NAMES[i] << " " << entry.configs[i] << std::endl;
+    }
+    out << "groups " << entry.groups.size();
+    for (auto g : entry.groups) {
+        out << " " << g;
+    }
+    out << std::endl;
+    out << "allocated_size " << entry.allocated_size << std::endl;
+    out << "reserved_size " << entry.reserved_size << std::endl;
+    out << "overhead_us " << entry.overhead_us << std::endl;
+    out << "search_mode " << entry.search_mode << std::endl;
+    out << "objective " << entry.objective << std::endl;
+    out << "num_evaluated " << entry.num_evaluated << std::endl;
+    out << "search_seconds " << entry.search_seconds << std::endl;
+    out << "warm_start " << (entry.warm_start.empty() ? "none" : entry.warm_start) << std::endl;
+    out << "created " << entry.created << std::endl;
+    // the histogram comes last, it is the bulk of the entry
+    for (auto& s : entry.signature.size_counts) {
+        out << "size " << s.first << " " << s.second << std::endl;
+    }
+    out.close();
+    if (out.fail()) {
+        error = "cannot write " + temp_filename;
+        fs::remove(temp_filename, ec);
+        return false;
+    }
+    fs::rename(temp_filename, filename, ec);
+    if (ec) {
+        error = "cannot rename " + temp_filename + " to " + filename + ": " + ec.message();
+        fs::remove(temp_filename, ec);
+        return false;
+    }
+    return true;
+}
+
+bool configStore::load(const std::string& filename, StoredConfigs& entry, std::string& error) const {
+    std::ifstream input(filename);
+    if (!input) {
+        error = "cannot read " + filename;
+        return false;
+    }
+    StoredConfigs loaded;
+    int version = 0;
+    std::string line;
+    size_t line_number = 0;
+    while (std::getline(input, line)) {
+        line_number++;
+        std::istringstream words(line);
+        std::string name;
+        if (!(words >> name)) {
+            continue;
+        }
+        auto config = std::find(CONFIG_NAMES.begin(), CONFIG_NAMES.end(), name);
+        bool good = true;
+        if (name == "version") {
+            good = static_cast<bool>(words >> version);
+        } else if (name == "signature") {
+            good = static_cast<bool>(words >> loaded.signature.hash);
+        } else if (config != CONFIG_NAMES.end()) {
+            good = static_cast<bool>(words >> loaded.configs[config - CONFIG_NAMES.begin()]);
+        } else if (name == "groups") {
+            // ascending as allocatorConf::_GROUPS, read one by one instead of resized to the count
+            size_t num_groups = 0;
+            good = static_cast<bool>(words >> num_groups) && num_groups <= MAX_GROUPS;
+            loaded.groups.clear();
+            for (size_t i = 0; good && i < num_groups; i++) {
+                size_t g = 0;
+                good = static_cast<bool>(words >> g) && (loaded.groups.empty() || g > loaded.groups.back());
+                loaded.groups.push_back(g);
+            }
+        } else if (name == "allocated_size") {
+            good = static_cast<bool>(words >> loaded.allocated_size);
+        } else if (name == "reserved_size") {
+            good = static_cast<bool>(words >> loaded.reserved_size);
+        } else if (name == "overhead_us") {
+            good = static_cast<bool>(words >> loaded.overhead_us);
+        } else if (name == "search_mode") {
+            good = static_cast<bool>(words >> loaded.search_mode);
+        } else if (name == "objective") {
+            good = static_cast<bool>(words >> loaded.objective);
+        } else if (name == "num_evaluated") {
+            good = static_cast<bool>(words >> loaded.num_evaluated);
+        } else if (name == "search_seconds") {
+            good = static_cast<bool>(words >> loaded.search_seconds);
+        } else if (name == "warm_start") {
+            good = static_cast<bool>(words >> loaded.warm_start);
+            if (loaded.warm_start == "none") {
+                loaded.warm_start.clear();
+            }
+        } else if (name == "created") {
+            good = static_cast<bool>(words >> loaded.created);
+        } else if (name == "size") {
+            size_t size = 0;
+            size_t count = 0;
+            good = static_cast<bool>(words >> size >> count);
+            loaded.signature.size_counts[size] = count;
+        }
+        // the unknown names are skipped, so an entry can be read by an older build of the same version
+        if (!good) {
+            error = filename + ":" + std::to_string(line_number) + ": bad entry " + line;
+            return false;
+        }
+        if (name == "version" && version != VERSION) {
+            error = filename + ": version " + std::to_string(version) + ", expected " + std::to_string(VERSION);
+            return false;
+        }
+    }
+    if (version != VERSION || loaded.signature.hash.empty()) {
+        error = filename + ": no version or signature";
+        return false;
+    }
+    entry = std::move(loaded);
+    return true;
+}
+
+bool configStore::find(const WorkloadSignature& signature, const std::string& search_mode,
+                       const std::string& objective, double min_similarity,
+                       StoredConfigs& entry, double& similarity) const {
+    std::error_code ec;
+    if (!fs::is_directory(directory, ec)) {
+        return false;
+    }
+    std::string error;
+    auto same_search = [&](const StoredConfigs& e) {
+        return e.search_mode == search_mode && e.objective == objective;
+    };
+    auto exact = get_filename(signature.hash, search_mode, objective);
+    if (fs::exists(exact, ec) && load(exact, entry, error) && entry.signature.hash == signature.hash &&
+        same_search(entry)) {
+        similarity = 1.0;
+        return true;
+    }
+
+    bool found = false;
+    similarity = 0.0;
+    // an unreadable directory or entry ends the scan instead of throwing
+    for (fs::directory_iterator file(directory, ec), end; !ec && file != end; file.increment(ec)) {
+        if (file->path().extension() != ENTRY_EXTENSION) {
+            continue;
+        }
+        StoredConfigs candidate;
+        if (!load(file->path().string(), candidate, error)) {
+            std::cout << "[configStore::find()] skip " << error << std::endl;
+            continue;
+        }
+        if (!same_search(candidate)) {
+            continue;
+        }
+        auto s = signature.similarity(candidate.signature);
+        if (s >= min_similarity && s > similarity) {
+            similarity = s;
+            entry = std::move(candidate);
+            found = true;
+        }
+    }
+    return found;
+}
+
+}  // namespace AllocatorSim
+}  // namespace cuda
+}  // namespace c10
@@ -0,0 +1,101 @@
+#include "allocator_grouping.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+namespace c10 {
+namespace cuda {
+namespace AllocatorSim {
+
+void sizeGrouper::add(size_t size, size_t count) {
+    size_counts[size] += count;
+}
+
+std::vector<size_t> sizeGrouper::partition(size_t num_groups) {
+    std::vector<size_t> boundaries;
+    waste = 0.0;
+    auto n = size_counts.size();
+    if (n == 0 || num_groups == 0) {
+        return boundaries;
+    }
+    std::vector<size_t> sizes;
+    // prefix sums of the counts and the requested bytes
+    std::vector<double> counts {0.0};
+    std::vector<double> bytes {0.0};
+    for (auto& s : size_counts) {
+        sizes.push_back(s.first);
+        counts.push_back(counts.back() + s.second);
+        bytes.push_back(bytes.back() + static_cast<double>(s.first) * s.second);
+    }
+    if (num_groups >= n) {
+        return sizes;
+    }
+
+    // waste of the sizes [a, b] rounded up to the size b
+    auto cost = [&](size_t a, size_t b) {
+        return static_cast<double>(sizes[b]) * (counts[b + 1] - counts[a]) - (bytes[b + 1] - bytes[a]);
+    };
+
+    // dp[k][b]: least waste of the sizes [0, b] in k + 1 groups, split[k][b]: first size of the last group.
+    // The cost has the quadrangle inequality, so the best split point of b is monotone in b
+    // and each row is filled by divide and conquer.
+    const double inf = std::numeric_limits<double>::infinity();
+    std::vector<std::vector<double>> dp(num_groups, std::vector<double>(n, inf));
+    std::vector<std::vector<size_t>> split(num_groups, std::vector<size_t>(n, 0));
+    for (size_t b = 0; b < n; b++) {
+        dp[0][b] = cost(0, b);
+    }
+    for (size_t k = 1; k < num_groups; k++) {
+        std::function<void(size_t, size_t, size_t, size_t)> fill =
+            [&](size_t lo, size_t hi, size_t split_lo, size_t split_hi) {
+            if (lo > hi) {
+                return;
+            }
+            size_t b = lo + (hi - lo) / 2;
+            size_t best_split = split_lo;
+            // the last group starts at a > 0, after the k groups of [0, a - 1]
+            for (size_t a = std::max(split_lo, k); a <= std::min(split_hi, b); a++) {
+                double c = dp[k - 1][a - 1] + cost(a, b);
+                if (c < dp[k][b]) {
+                    dp[k][b] = c;
+                    best_split = a;
+                }
+            }
+            split[k][b] = best_split;
+            if (b > lo) {
+                fill(lo, b - 1, split_lo, best_split);
+            }
+            fill(b + 1, hi, best_split, split_hi);
+        };
+        fill(k, n - 1, k, n - 1);
+    }
+
+    // walk the splits back from the largest size
+    size_t b = n - 1;
+    size_t k = num_groups - 1;
+    waste = dp[k][b] / counts[n];
+    while (true) {
+        boundaries.push_back(sizes[b]);
+        if (k == 0) {
+            break;
+        }
+        auto a = split[k][b];
+        b = a - 1;
+        k--;
+    }
+    std::reverse(boundaries.begin(), boundaries.end());
+    return boundaries;
+}
+
+double sizeGrouper::get_waste() const {
+    return waste;
+}
+
+size_t sizeGrouper::get_num_sizes() const {
+    return size_counts.size();
+}
+
+}  // namespace AllocatorSim
+}  // namespace cuda
+}  // namespace c10
@@ -0,0 +1,100 @@
+#include "allocator_latency.h"
+
+#include <fstream>
+#include <map>
+#include <sstream>
+
+namespace c10 {
+namespace cuda {
+namespace AllocatorSim {
+
+namespace {
+    const double BYTES_PER_MB = 1048576.0;
+}   // anonymous namespace for variables
+
+AllocatorOpCounts& AllocatorOpCounts::operator+=(const AllocatorOpCounts& other) {
+    segment_allocs += other.segment_allocs;
+    segment_alloc_bytes += other.segment_alloc_bytes;
+    segment_releases += other.segment_releases;
+    segment_release_bytes += other.segment_release_bytes;
+    cache_flushes += other.cache_flushes;
+    pool_lookups += other.pool_lookups;
+    return *this;
+}
+
+AllocatorOpCounts AllocatorOpCounts::operator-(const AllocatorOpCounts& other) const {
+    AllocatorOpCounts counts;
+    counts.segment_allocs = segment_allocs - other.segment_allocs;
+    counts.segment_alloc_bytes = segment_alloc_bytes - other.segment_alloc_bytes;
+    counts.segment_releases = segment_releases - other.segment_releases;
+    counts.segment_release_bytes = segment_release_bytes - other.segment_release_bytes;
+    counts.cache_flushes = cache_flushes - other.cache_flushes;
+    counts.pool_lookups = pool_lookups - other.pool_lookups;
+    return counts;
+}
+
+AllocatorOpCounts AllocatorOpCounts::operator*(size_t n) const {
+    AllocatorOpCounts counts;
+    counts.segment_allocs = segment_allocs * n;
+    counts.segment_alloc_bytes = segment_alloc_bytes * n;
+    counts.segment_releases = segment_releases * n;
+    counts.segment_release_bytes = segment_release_bytes * n;
+    counts.cache_flushes = cache_flushes * n;
+    counts.pool_lookups = pool_lookups * n;
+    return counts;
+}
+
+size_t AllocatorOpCounts::get_segment_ops() const {
+    return segment_allocs + segment_releases;
+}
+
+double LatencyModel::estimate_us(const AllocatorOpCounts& counts) const {
+    return counts.segment_allocs * segment_alloc_us +
+        counts.segment_alloc_bytes / BYTES_PER_MB * segment_alloc_us_per_mb +
+        counts.segment_releases * segment_release_us +
+        counts.segment_release_bytes / BYTES_PER_MB * segment_release_us_per_mb +
+        counts.cache_flushes * cache_flush_us +
+        counts.pool_lookups * pool_lookup_us;
+}
+
+bool LatencyModel::load(const std::string& filename, std::string& error) {
+    std::ifstream input(filename);
+    if (!input) {
+        error = "cannot read " + filename;
+        return false;
+    }
+    const std::map<std::string, double LatencyModel::*> fields {
+        {"segment_alloc_us", &LatencyModel::segment_alloc_us},
+        {"segment_alloc_us_per_mb", &LatencyModel::segment_alloc_us_per_mb},
+        {"segment_release_us", &LatencyModel::segment_release_us},
+        {"segment_release_us_per_mb", &LatencyModel::segment_release_us_per_mb},
+        {"cache_flush_us", &LatencyModel::cache_flush_us},
+        {"pool_lookup_us", &LatencyModel::pool_lookup_us},
+    };
+    // parsed into a copy, a bad table leaves the model as it was
+    auto loaded = *this;
+    std::string line;
+    size_t line_number = 0;
+    while (std::getline(input, line)) {
+        line_number++;
+        line = line.substr(0, line.find('#'));
+        std::istringstream words(line);
+        std::string name;
+        double value;
+        if (!(words >> name)) {
+            continue;
+        }
+        auto field = fields.find(name);
+        if (field == fields.end() || !(words >> value) || value < 0) {
+            error = filename + ":" + std::to_string(line_number) + ": bad entry " + line;
+            return false;
+        }
+        loaded.*(field->second) = value;
+    }
+    *this = loaded;
+    return true;
+}
+
+}  // namespace AllocatorSim
+}  // namespace cuda
+}  // namespace c10
@@ -7,6 +7,7 @@
 #include "utils/sanitizer_api.h"
 
 #include <fstream>
+#include <algorithm>
 
 namespace c10 {
 namespace cuda {
@@ -21,11 +22,35 @@ namespace {
     std::map<std::string, std::pair<size_t, size_t>> static_tensor_callpaths;
     std::set<std::string> reclaimed_callpaths;
     std::map<void*, std::string> ptr2callpath;
+    // <malloc_op_id, callpath_hash>, when MEMORY_PLANNING or PEAK_ATTRIBUTION is on
+    std::map<op_id_t, std::string> opid2callpath;
+    // the global op_id at the end of each iteration
+    std::vector<op_id_t> iteration_boundaries;
     std::string dump_file_name = "optimized_configs.txt";
+    std::string plan_file_name = "static_memory_plan.txt";
+    std::string timeline_file_name = "./output/timeline.json";
+    std::string peak_file_name = "./output/peak_attribution.txt";
+    std::string compressed_trace_file_name = "./output/trace.compressed";
+    std::string binary_trace_file_name = "./output/trace.bin";
+    std::string sensitivity_file_name = "./output/sensitivity.csv";
+    std::string pareto_file_name = "./output/pareto_front.csv";
+    std::string config_store_directory = "./output/config_store";
+    // first line of the opt guidance file, bumped when its format changes
+    const std::string OPT_GUIDANCE_HEADER = "# allocatorsim opt guidance v1";
+    // far above the group counts searched, a larger count is a corrupt file
+    const size_t MAX_OPT_GUIDANCE_GROUPS = 4096;
+    // the least size histogram similarity of a stored workload to warm-start from
+    const double MIN_WARM_START_SIMILARITY = 0.8;
+
+    SearchTradeoff search_tradeoff;
+    LatencyModel latency_model;
 
 
     std::set<std::string> unique_hash_trace;
 
+    // <callpath id of the tracer, callpath_hash>, each callpath is hashed once
+    std::unordered_map<uint64_t, std::string> callpath_hashes;
+
     Configs original_configs;
     Configs searched_configs;
 }   // namespace
@@ -33,32 +58,66 @@ namespace {
 const static size_t MAX_NUM_STATES = 30;
 thread_local static python_state_t python_states[MAX_NUM_STATES];
 
-void load_opt_guidance(std::string filename) {
+// false if the file is missing, of another version or truncated, the configs and groups
+// loaded before are kept then
+bool load_opt_guidance(std::string filename) {
     std::ifstream in(filename);
-    assert(in.good() && "Cannot open the file");
-    in >> searched_configs.kMinBlockSize;
-    in >> searched_configs.kSmallSize;
-    in >> searched_configs.kSmallBuffer;
-    in >> searched_configs.kLargeBuffer;
-    in >> searched_configs.kMinLargeAlloc;
-    in >> searched_configs.kRoundLarge;
+    if (!in) {
+        std::cout << "[load_opt_guidance()] cannot read " << filename << std::endl;
+        return false;
+    }
+    auto fail = [&filename](const std::string& reason) {
+        std::cout << "[load_opt_guidance()] " << filename << ": " << reason << ", the guidance is not applied" << std::endl;
+        return false;
+    };
+    std::string line;
+    if (!std::getline(in, line) || line != OPT_GUIDANCE_HEADER) {
+        return fail("no header " + OPT_GUIDANCE_HEADER);
+    }
 
-    if (sim_control::SimulatorModeController::is_group_optimization()) {
-        for (size_t i = 0; i < allocatorConf::_GROUPS.size(); i++) {
-            in >> allocatorConf::_GROUPS[i];
-        }
+    Configs configs = searched_configs;
+    if (!(in >> configs.kMinBlockSize >> configs.kSmallSize >> configs.kSmallBuffer
+             >> configs.kLargeBuffer >> configs.kMinLargeAlloc >> configs.kRoundLarge)) {
+        return fail("truncated configs");
+    }
 
-        if (allocatorConf::_GROUPS[0] < std::numeric_limits<size_t>::max()) {
-            group_enable_flag = true;
+    size_t num_groups = 0;
+    if (!(in >> num_groups)) {
+        return fail("no group count");
+    }
+    if (num_groups > MAX_OPT_GUIDANCE_GROUPS) {
+        return fail(std::to_string(num_groups) + " groups, at most " + std::to_string(MAX_OPT_GUIDANCE_GROUPS));
+    }
+    std::vector<size_t> groups;
+    for (size_t i = 0; i < num_groups; i++) {
+        size_t group = 0;
+        if (!(in >> group)) {
+            return fail("group " + std::to_string(i) + " of " + std::to_string(num_groups) + " is missing");
+        }
+        // get_group_size() searches them in ascending order
+        if (!groups.empty() && group <= groups.back()) {
+            return fail("groups are not ascending");
         }
+        groups.push_back(group);
     }
 
-    std::string line;
+    std::set<std::string> callpaths;
     while (std::getline(in, line)) {
-        unique_hash_trace.emplace(line);
+        if (!line.empty()) {
+            callpaths.emplace(line);
+        }
     }
     in.close();
 
+    searched_configs = configs;
+    if (sim_control::SimulatorModeController::is_group_optimization()) {
+        allocatorConf::_GROUPS = std::move(groups);
+        if (!allocatorConf::_GROUPS.empty()) {
+            group_enable_flag = true;
+        }
+    }
+    unique_hash_trace.insert(callpaths.begin(), callpaths.end());
+
     std::cout << searched_configs.kMinBlockSize << std::endl;
     std::cout << searched_configs.kSmallSize << std::endl;
     std::cout << searched_configs.kSmallBuffer << std::endl;
@@ -68,10 +127,12 @@ void load_opt_guidance(std::string filename) {
     for (auto htrace : unique_hash_trace) {
         std::cout << htrace << std::endl;
     }
+    return true;
 }
 
 void dump_opt_guidance(std::string filename) {
     std::ofstream out(filename);
+    out << OPT_GUIDANCE_HEADER << std::endl;
     out << searched_configs.kMinBlockSize << std::endl;
     out << searched_configs.kSmallSize << std::endl;
     out << searched_configs.kSmallBuffer << std::endl;
@@ -79,7 +140,10 @@ void dump_opt_guidance(std::string filename) {
     out << searched_configs.kMinLargeAlloc << std::endl;
     out << searched_configs.kRoundLarge << std::endl;
 
-    if (sim_control::SimulatorModeController::is_group_optimization()) {
+    // the group count is always written so the file is read the same in every mode
+    bool groups = sim_control::SimulatorModeController::is_group_optimization();
+    out << (groups ? allocatorConf::_GROUPS.size() : 0) << std::endl;
+    if (groups) {
         for (size_t i = 0; i < allocatorConf::_GROUPS.size(); i++) {
             out << allocatorConf::_GROUPS[i] << std::endl;
         }
@@ -103,6 +167,24 @@ void set_profiling_mode(bool mode) {
     }
 }
 
+void set_search_tradeoff(const SearchTradeoff& tradeoff) {
+    search_tradeoff = tradeoff;
+}
+
+bool load_latency_model(const std::string& filename) {
+    std::string error;
+    if (!latency_model.load(filename, error)) {
+        std::cout << "[load_latency_model()] " << error << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void set_config_store(const std::string& directory) {
+    config_store_directory = directory;
+    sim_control::SimulatorModeController::set_config_store(true);
+}
+
 /********************************************************************************
  ******************** Function definitions of allocatorMgr **********************
 ********************************************************************************/
@@ -126,6 +208,11 @@ allocatorMgr::allocatorMgr(int device, int stream) {
         // load_opt_guidance(dump_file_name);
         apply_configs(searched_configs);
     }
+
+    if (sim_control::SimulatorModeController::is_profiling() &&
+        sim_control::SimulatorModeController::is_online_simulation()) {
+        start_online_simulation();
+    }
 }
 
 allocatorMgr::~allocatorMgr() {
@@ -147,11 +234,48 @@ allocatorMgr::~allocatorMgr() {
 
 void allocatorMgr::test_simulator() {
     process_trace();
+    replay_compiled_trace();
+}
+
+void allocatorMgr::replay_compiled_trace() {
+    if (sim_control::SimulatorModeController::is_peak_attribution()) {
+        attribute_peak_memory();
+    }
+    open_timeline();
     auto memory_usage = simulate_allocator();
-    std::cout << "Max reserved size: " << memory_usage << std::endl << std::endl;
+    close_timeline();
+    std::cout << "Max reserved size: " << memory_usage << std::endl;
+    std::cout << "Allocator overhead: " << get_overhead_us(replay_op_counts) << " us per iteration, "
+              << get_num_iterations() << " iterations, " << replay_op_counts.segment_allocs << " segment allocs, "
+              << replay_op_counts.segment_releases << " releases, " << replay_op_counts.cache_flushes
+              << " cache flushes" << std::endl << std::endl;
+    if (online_active.load(std::memory_order_acquire)) {
+        finish_online_simulation();
+    }
+    if (sim_control::SimulatorModeController::is_sensitivity_analysis()) {
+        analyze_sensitivity();
+    }
     search_config_with_group();
 }
 
+void allocatorMgr::test_simulator(std::vector<ReplaySlot>&& slots, std::map<op_id_t, AllocatorEventType_t>&& api_trace) {
+    _api_trace.merge(api_trace);
+    flush_trace();
+    // collected blocks are merged, and compression and dumping work on the block map
+    if (!_block_trace.empty() || !_active_blocks.empty() || compressed_trace.get_num_blocks() > 0 ||
+        sim_control::SimulatorModeController::is_trace_compression() ||
+        sim_control::SimulatorModeController::is_trace_dumpping()) {
+        for (auto& slot : slots) {
+            _block_trace.emplace(slot.malloc_op_id, std::make_pair(slot.free_op_id, slot.size));
+        }
+        test_simulator();
+        return;
+    }
+    replay_slots = std::move(slots);
+    compile_events();
+    replay_compiled_trace();
+}
+
 bool allocatorMgr::check_constraints() {
     if (allocatorConf::get_kMinLargeAlloc() >= allocatorConf::get_kLargeBuffer()) {
         return false;
@@ -169,36 +293,42 @@ bool allocatorMgr::check_configs(Configs& config) {
 }
 
 void allocatorMgr::search_group() {
-    log_configs(original_configs);
-    reset_allocator_memory_usage();
+    log_original_configs();
     empty_cache();
+    reset_allocator_memory_usage();
     // get the result without grouping
     evaluate_allocator(original_configs, original_configs);
 
-    for (auto diff : GROUP_DIFFERENCES) {
-        group_blocks(diff);
+    // fewer groups waste more bytes in rounding but reuse more segments,
+    // so the optimal groups of each count are replayed
+    for (auto num_groups : GROUP_COUNTS) {
+        auto num_sizes = group_blocks_by_waste(num_groups);
+        if (num_sizes == 0) {
+            break;
+        }
         if (evaluate_allocator(original_configs, original_configs)) {
-            current_difference = diff;
             allocatorConf::BACKUP_GROUPS = allocatorConf::_GROUPS;
-            // alloc_sim.set_group_enable_flag_sim(true);
             group_enable_flag = true;
-        } else if(group_enable_flag) {
+        } else if (group_enable_flag) {
             // rollback
             allocatorConf::_GROUPS = allocatorConf::BACKUP_GROUPS;
-        } else if (!group_enable_flag) {
+        } else {
             // disable group in sim
             alloc_sim.set_group_enable_flag_sim(false);
         }
-        reset_allocator_memory_usage();
         empty_cache();
+        reset_allocator_memory_usage();
+        // every size has its own group
+        if (num_groups >= num_sizes) {
+            break;
+        }
     }
     evaluate_allocator(original_configs, original_configs);
     log_configs(searched_configs);
     std::cout << "[allocatorMgr::search_group()]" << std::endl;
     report_configs(original_configs, searched_configs);
-    if (group_enable_flag) {
-        std::cout << "Group difference: " << current_difference << std::endl;
-    } else {
+    report_pareto_front();
+    if (!group_enable_flag) {
         std::cout << "No group" << std::endl;
     }
 }
@@ -217,8 +347,17 @@ void allocatorMgr::allocator_assert(bool expr) {
 bool allocatorMgr::evaluate_allocator(Configs configs, Configs prev_conf) {
     apply_configs(configs);
     auto reserved_size = simulate_allocator();
-    if (reserved_size < current_reserved_size) {
-        current_reserved_size = std::min(current_reserved_size, reserved_size);
+    num_evaluated++;
+    configs.allocated_size = get_max_allocated_bytes();
+    configs.reserved_size = reserved_size;
+    configs.overhead_us = get_overhead_us(replay_op_counts);
+    // the groups are kept after a rejected group search, but not replayed
+    auto groups = alloc_sim.get_group_enable_flag_sim() ? allocatorConf::_GROUPS : std::vector<size_t>();
+    pareto_front.insert(replay_cost, std::make_pair(configs, groups));
+    auto cost = search_tradeoff.cost(replay_cost);
+    if (cost < current_cost) {
+        current_cost = cost;
+        current_reserved_size = reserved_size;
         std::cout << "reserved size: " << reserved_size << std::endl;
         return true;
     } else {
@@ -228,16 +367,17 @@ bool allocatorMgr::evaluate_allocator(Configs configs, Configs prev_conf) {
 }
 
 void allocatorMgr::search_config() {
-    log_configs(original_configs);
-    reset_allocator_memory_usage();
+    log_original_configs();
     empty_cache();
+    reset_allocator_memory_usage();
+    lookup_config_store("config");
     auto prev_conf = original_configs;
-    for (auto kMinBlockSize : kMinBlockSize_candidates) {
-        for (auto kSmallSize : kSmallSize_candidates) {
-            for (auto kSmallBuffer : kSmallBuffer_candidates) {
-                for (auto kLargeBuffer : kLargeBuffer_candidates) {
-                    for (auto kMinLargeAlloc : kMinLargeAlloc_candidates) {
-                        for (auto kRoundLarge : kRoundLarge_candidates) {
+    for (auto kMinBlockSize : search_candidates[0]) {
+        for (auto kSmallSize : search_candidates[1]) {
+            for (auto kSmallBuffer : search_candidates[2]) {
+                for (auto kLargeBuffer : search_candidates[3]) {
+                    for (auto kMinLargeAlloc : search_candidates[4]) {
+                        for (auto kRoundLarge : search_candidates[5]) {
                             searched_configs = Configs(
                                 kMinBlockSize,
                                 kSmallSize,
@@ -252,8 +392,8 @@ void allocatorMgr::search_config() {
                             if (evaluate_allocator(searched_configs, prev_conf)) {
                                 prev_conf = searched_configs;
                             }
-                            reset_allocator_memory_usage();
                             empty_cache();
+                            reset_allocator_memory_usage();
                         }
                     }
                 }
@@ -265,23 +405,27 @@ void allocatorMgr::search_config() {
     log_configs(searched_configs);
     std::cout << "[allocatorMgr::search_config()]" << std::endl;
     report_configs(original_configs, searched_configs);
+    report_pareto_front();
+    save_config_store("config");
+    configs_searched = true;
 
     // search_config_with_group();
 }
 
 // after search group
 void allocatorMgr::search_config_with_group() {
-    log_configs(original_configs);
-    reset_allocator_memory_usage();
+    log_original_configs();
     empty_cache();
+    reset_allocator_memory_usage();
+    lookup_config_store("config_with_group");
     searched_configs = original_configs;
     auto prev_conf = searched_configs;
-    for (auto kMinBlockSize : kMinBlockSize_candidates) {
-        for (auto kSmallSize : kSmallSize_candidates) {
-            for (auto kSmallBuffer : kSmallBuffer_candidates) {
-                for (auto kLargeBuffer : kLargeBuffer_candidates) {
-                    for (auto kMinLargeAlloc : kMinLargeAlloc_candidates) {
-                        for (auto kRoundLarge : kRoundLarge_candidates) {
+    for (auto kMinBlockSize : search_candidates[0]) {
+        for (auto kSmallSize : search_candidates[1]) {
+            for (auto kSmallBuffer : search_candidates[2]) {
+                for (auto kLargeBuffer : search_candidates[3]) {
+                    for (auto kMinLargeAlloc : search_candidates[4]) {
+                        for (auto kRoundLarge : search_candidates[5]) {
                             searched_configs = Configs(
                                 kMinBlockSize,
                                 kSmallSize,
@@ -296,16 +440,17 @@ void allocatorMgr::search_config_with_group() {
                             if (evaluate_allocator(searched_configs, prev_conf)) {
                                 prev_conf = searched_configs;
                             }
-                            reset_allocator_memory_usage();
                             empty_cache();
+                            reset_allocator_memory_usage();
 
-                            for (auto diff : GROUP_DIFFERENCES) {
-                                group_blocks(diff);
+                            for (auto num_groups : search_group_counts) {
+                                auto num_sizes = group_blocks_by_waste(num_groups);
+                                if (num_sizes == 0) {
+                                    break;
+                                }
                                 if (evaluate_allocator(searched_configs, prev_conf)) {
                                     prev_conf = searched_configs;
-                                    current_difference = diff;
                                     allocatorConf::BACKUP_GROUPS = allocatorConf::_GROUPS;
-                                    // alloc_sim.set_group_enable_flag_sim(true);
                                     group_enable_flag = true;
                                 } else if(group_enable_flag) {
                                     // rollback
@@ -313,8 +458,11 @@ void allocatorMgr::search_config_with_group() {
                                 } else if (!group_enable_flag) {
                                     alloc_sim.set_group_enable_flag_sim(false);
                                 }
-                                reset_allocator_memory_usage();
                                 empty_cache();
+                                reset_allocator_memory_usage();
+                                if (num_groups >= num_sizes) {
+                                    break;
+                                }
                             }
                         }
                     }
@@ -327,6 +475,46 @@ void allocatorMgr::search_config_with_group() {
     log_configs(searched_configs);
     std::cout << "[allocatorMgr::search_config_with_group()]" << std::endl;
     report_configs(original_configs, searched_configs);
+    report_pareto_front();
+    save_config_store("config_with_group");
+    configs_searched = true;
+}
+
+void allocatorMgr::report_pareto_front() {
+    auto points = pareto_front.get_points();
+    std::sort(points.begin(), points.end(), [](const auto& a, const auto& b) {
+        return a.first.reserved_size < b.first.reserved_size;
+    });
+    auto is_applied = [this](const ConfigCost& c) {
+        return c.reserved_size == replay_cost.reserved_size && c.segment_ops == replay_cost.segment_ops &&
+            c.fragmentation == replay_cost.fragmentation;
+    };
+
+    auto path = fs::path(pareto_file_name).parent_path();
+    if (!fs::is_directory(path)) {
+        fs::create_directories(path);
+    }
+    std::ofstream csv(pareto_file_name);
+    csv << "reserved_bytes,segment_ops,fragmentation_bytes,overhead_us,tradeoff_cost,kMinBlockSize,kSmallSize,"
+        << "kSmallBuffer,kLargeBuffer,kMinLargeAlloc,kRoundLarge,num_groups,applied" << std::endl;
+    std::cout << "[allocatorMgr::report_pareto_front()] " << points.size() << " configs on the front, "
+              << "segment op: " << format_size(search_tradeoff.segment_op_bytes)
+              << ", fragmentation weight: " << search_tradeoff.fragmentation_weight << std::endl;
+    for (auto& p : points) {
+        auto& c = p.second.first;
+        auto num_groups = p.second.second.size();
+        bool applied = is_applied(p.first);
+        csv << p.first.reserved_size << "," << p.first.segment_ops << "," << p.first.fragmentation << ","
+            << c.overhead_us << "," << search_tradeoff.cost(p.first) << "," << c.kMinBlockSize << "," << c.kSmallSize << ","
+            << c.kSmallBuffer << "," << c.kLargeBuffer << "," << c.kMinLargeAlloc << "," << c.kRoundLarge << ","
+            << num_groups << "," << applied << std::endl;
+        std::cout << (applied ? "* " : "  ") << "reserved " << format_size(p.first.reserved_size)
+                  << ", " << p.first.segment_ops << " segment ops, fragmentation "
+                  << format_size(p.first.fragmentation) << ", overhead " << c.overhead_us << " us/iter"
+                  << (num_groups ? ", " + std::to_string(num_groups) + " groups" : "") << std::endl;
+    }
+    csv.close();
+    pareto_front.clear();
 }
 
 void allocatorMgr::log_configs(Configs& configs, bool get_mem) {
@@ -346,26 +534,53 @@ void allocatorMgr::log_configs(Configs& configs, bool get_mem) {
         allocated_size,
         reserved_size
     );
+    if (get_mem) {
+        configs.overhead_us = get_overhead_us(replay_op_counts);
+    }
 }
 
-void allocatorMgr::process_empty_cache_api() {
+size_t allocatorMgr::get_num_iterations() {
+    if (num_iterations > 0) {
+        return num_iterations;
+    }
+    // the traced iterations, or the periods of the malloc sizes of a trace file
+    num_iterations = iteration_boundaries.size();
+    if (num_iterations == 0) {
+        std::vector<size_t> sizes;
+        sizes.reserve(replay_slots.size());
+        for (auto& slot : replay_slots) {
+            sizes.push_back(slot.size);
+        }
+        auto period = std::max<size_t>(compressedTrace::detect_period(sizes), 1);
+        num_iterations = std::max<size_t>((sizes.size() + period - 1) / period, 1);
+    }
+    return num_iterations;
+}
+
+double allocatorMgr::get_overhead_us(const AllocatorOpCounts& counts) {
+    return latency_model.estimate_us(counts) / get_num_iterations();
+}
+
+void allocatorMgr::process_empty_cache_api(op_id_t op_id) {
     if (!sim_control::SimulatorModeController::is_async_tracing()) {
         empty_cache();
     } else {
         // collect emtpy cache event
-        _api_trace.emplace(get_global_op_id(), ALLOCATOR_EMPYT_CACHE);
+        _api_trace.emplace(op_id, ALLOCATOR_EMPYT_CACHE);
     }
 }
 
 void allocatorMgr::collect_api(AllocatorEventType_t api_type) {
+    auto op_id = online_active.load(std::memory_order_acquire) ? online_sim->push_empty_cache()
+                                                               : next_global_op_id();
     if (api_type == ALLOCATOR_EMPYT_CACHE) {
-        process_empty_cache_api();
+        process_empty_cache_api(op_id);
     }
-    increase_global_op_id();
 }
 
 // For functionality test
 void allocatorMgr::test_functionality_under_collect_trace_async() {
+    flush_trace();
     if (!_active_blocks.empty()) {
         for (auto b : _active_blocks) {
             _block_trace.emplace(b.second.first, std::make_pair(get_global_op_id(), b.second.second));
@@ -383,6 +598,7 @@ void allocatorMgr::test_functionality_under_collect_trace_async() {
 
 // check the functionality of the simulator by synchronously running it
 void allocatorMgr::collect_trace_sync(void* ptr, int64_t size, bool real) {
+    alloc_sim.set_op_id(get_global_op_id());
     if (size > 0) {  // malloc
         Block* block = this->alloc_sim.malloc(this->device, size, this->stream);
         free_blocks.emplace(reinterpret_cast<uint64_t>(ptr), block);
@@ -399,17 +615,10 @@ void allocatorMgr::collect_trace_sync(void* ptr, int64_t size, bool real) {
 
 // check the simulation functionality of the simulator by asynchronously running it (run after trace collection)
 void allocatorMgr::collect_trace_async(void* ptr, int64_t size, bool real) {
-    if (size > 0) {  // malloc
-        _active_blocks.emplace(ptr, std::make_pair(get_global_op_id(), size));
-    } else {  // free
-        if (real) { // release the block
-            return ;
-        }
-        auto b = _active_blocks.find(ptr);
-        _block_trace.emplace(b->second.first, std::make_pair(get_global_op_id(), b->second.second));
-        _active_blocks.erase(b);
+    if (size < 0 && real) { // release the block
+        return ;
     }
-    increase_global_op_id();
+    tracer.append(next_global_op_id(), ptr, size);
 }
 
 void allocatorMgr::collect_trace(void* ptr, int64_t size, bool real) {
@@ -425,6 +634,7 @@ void allocatorMgr::collect_trace(void* ptr, int64_t size, bool real) {
 }
 
 void allocatorMgr::optimize_functionality() {
+    flush_trace();
     if (!_active_blocks.empty()) {
         for (auto b : _active_blocks) {
             _block_trace.emplace(b.second.first, std::make_pair(get_global_op_id(), b.second.second));
@@ -434,73 +644,34 @@ void allocatorMgr::optimize_functionality() {
 
     process_trace();
     current_reserved_size = simulate_allocator();
+    current_cost = search_tradeoff.cost(replay_cost);
     search_config();
 
     dump_opt_guidance(dump_file_name);
 }
 
 void allocatorMgr::collect_trace_opt(void* ptr, int64_t size, bool real) {
-    if (size > 0) {  // malloc
-        _active_blocks.emplace(ptr, std::make_pair(get_global_op_id(), size));
-
-    } else {  // free
-        if (real) { // release the block
-            return ;
-        }
-        auto b = _active_blocks.find(ptr);
-        _block_trace.emplace(b->second.first, std::make_pair(get_global_op_id(), b->second.second));
-        _active_blocks.erase(b);
+    if (size < 0 && real) { // release the block
+        return ;
     }
-    increase_global_op_id();
+    tracer.append(next_global_op_id(), ptr, size);
 }
 
 // @Lin-Mao(todo): a issue to be investigated: the gap of dynamic tensors simulation even larger than the original one
 void allocatorMgr::collect_trace_opt2(void* ptr, int64_t size, bool real) {
-    if (size > 0) {  // malloc
-        if (sim_control::SimulatorModeController::is_profiling()) {
-            auto callpath = get_callpath_hash();
-            ptr2callpath.emplace(ptr, callpath);
-
-            // static tensor analysis
-            // static tensors is the tensors that are at first iteration and never reclaimed in the later iterations
-            if (reclaimed_callpaths.find(callpath) == reclaimed_callpaths.end()) {
-                auto static_tensor_cp = static_tensor_callpaths.find(callpath);
-                if (iteration == 0) {
-                    if (static_tensor_cp == static_tensor_callpaths.end()) {
-                        static_tensor_callpaths.emplace(callpath, std::make_pair(size, 1));
-                    } else {
-                        static_tensor_cp->second.first += size;
-                        static_tensor_cp->second.second += 1;
-                    }
-                } else {
-                    if (static_tensor_cp != static_tensor_callpaths.end()) {
-                        static_tensor_cp->second.first += size;
-                        static_tensor_cp->second.second += 1;
-                    }
-                }
-            }
-        }
-        _active_blocks.emplace(ptr, std::make_pair(get_global_op_id(), size));
-    } else {  // free
-        if (real) {
-            return ; // do nothing for real free, handled by empty_cache
-        }
-        if (sim_control::SimulatorModeController::is_profiling()) {
-            auto callpath = ptr2callpath.find(ptr);
-            if (callpath != ptr2callpath.end()) {
-                auto static_tensor_cp = static_tensor_callpaths.find(callpath->second);
-                if (static_tensor_cp != static_tensor_callpaths.end()) {
-                    static_tensor_callpaths.erase(static_tensor_cp);
-                }
-                reclaimed_callpaths.emplace(callpath->second);
-                ptr2callpath.erase(callpath);
-            } 
-        }
-        auto b = _active_blocks.find(ptr);
-        _block_trace.emplace(b->second.first, std::make_pair(get_global_op_id(), b->second.second));
-        _active_blocks.erase(b);
+    if (size < 0 && real) {
+        return ; // do nothing for real free, handled by empty_cache
+    }
+    auto op_id = online_active.load(std::memory_order_acquire) ? online_sim->push(ptr, size)
+                                                               : next_global_op_id();
+    // only the callpath is taken on this thread, record_callpaths() hashes and analyzes it
+    if (size > 0 && sim_control::SimulatorModeController::is_profiling()) {
+        auto callpath = get_callpath();
+        // odd ids, 0 marks an event without a callpath
+        tracer.append(op_id, ptr, size, std::hash<std::string>()(callpath) | 1, callpath);
+    } else {
+        tracer.append(op_id, ptr, size);
     }
-    increase_global_op_id();
 }
 
 char* allocatorMgr::malloc_cpu_memory_chunk(size_t size) {
@@ -514,32 +685,59 @@ void allocatorMgr::free_cpu_memory_chunk(char* pointer) {
 
 bool allocatorMgr::iter_end() {
     bool result = false;    // indicates whether applying a online optimization
+    // the raw events stay in the per-thread buffers, process_trace() pairs them once
+    iteration_boundaries.push_back(get_global_op_id());
     if (sim_control::SimulatorModeController::is_profiling()) {
         size_t max_monitored_iterations = 2;
         // search configs when reaching the max monitored iterations
         if (iteration == max_monitored_iterations) {
             process_trace();
-            current_reserved_size = simulate_allocator();
-            std::cout << "init_reserved_size: " << current_reserved_size << std::endl;
-            if (sim_control::SimulatorModeController::is_config_optimization()) {
-                search_config();
-            } else if (sim_control::SimulatorModeController::is_group_optimization()) {
-                search_config_with_group();
+            if (sim_control::SimulatorModeController::is_memory_planning()) {
+                plan_static_memory();
+            }
+            if (sim_control::SimulatorModeController::is_peak_attribution()) {
+                attribute_peak_memory();
+            }
+            bool background = sim_control::SimulatorModeController::is_background_search() &&
+                sim_control::SimulatorModeController::is_config_optimization();
+            bool online = online_active.load(std::memory_order_acquire);
+            if (online) {
+                current_reserved_size = finish_online_simulation();
+                // replayed below if the online simulation dropped events
+                online = current_reserved_size != std::numeric_limits<size_t>::max();
+                if (online) {
+                    current_cost = search_tradeoff.cost(replay_cost);
+                }
+            }
+            // the timeline needs a replay even if the online simulation is done,
+            // the background search replays the current configs itself
+            if ((!online && !background) || sim_control::SimulatorModeController::is_timeline_exporting()) {
+                open_timeline();
+                current_reserved_size = simulate_allocator();
+                current_cost = search_tradeoff.cost(replay_cost);
+                close_timeline();
+            }
+            if (current_reserved_size != std::numeric_limits<size_t>::max()) {
+                std::cout << "init_reserved_size: " << current_reserved_size << std::endl;
+            }
+            if (background) {
+                start_background_search();
+            } else {
+                if (sim_control::SimulatorModeController::is_config_optimization()) {
+                    search_config();
+                } else if (sim_control::SimulatorModeController::is_group_optimization()) {
+                    search_config_with_group();
+                }
+                // dump configs
+                dump_opt_guidance(dump_file_name);
             }
-            // dump configs
-            dump_opt_guidance(dump_file_name);
         }
     }
-    else {
-        if (false) { // change to optimize at program beginning, always false for now
-            process_trace();
-            current_reserved_size = simulate_allocator();
-            // search_config();
-            // search_group();
-            search_config_with_group();
-            result = true;
-            _active_blocks.clear();
-        }
+
+    // apply the configs of a finished background search at the iteration boundary
+    if (background_search && background_search->is_done()) {
+        apply_background_search();
+        result = true;
     }
 
     // ?: continuous profiling should clear trace after each iteration
@@ -558,7 +756,91 @@ bool allocatorMgr::iteration_trigger(bool begin) {
     return result;
 }
 
+void allocatorMgr::flush_trace() {
+    bool verbose = sim_control::SimulatorModeController::is_debug_dumpping();
+    auto start = verbose ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+    auto events = tracer.drain();
+    for (auto& e : events) {
+        if (e.size > 0) {  // malloc
+            _active_blocks.emplace(e.ptr, std::make_pair(e.op_id, e.size));
+        } else {  // free
+            auto b = _active_blocks.find(e.ptr);
+            if (b == _active_blocks.end()) {
+                continue;   // allocated before tracing started
+            }
+            _block_trace.emplace(b->second.first, std::make_pair(e.op_id, b->second.second));
+            _active_blocks.erase(b);
+        }
+    }
+    record_callpaths(events);
+    // runs once per processed trace, only reported when debugging
+    if (verbose && !events.empty()) {
+        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start);
+        std::cout << "[allocatorMgr::flush_trace()] " << events.size() << " events from "
+                  << tracer.get_num_threads() << " threads in " << duration.count() << " us" << std::endl;
+    }
+}
+
+void allocatorMgr::record_callpaths(const std::vector<TraceEvent>& events) {
+    // the texts of the callpaths not hashed yet, fetched at most once
+    std::unordered_map<uint64_t, std::string> texts;
+    bool keep_op_ids = sim_control::SimulatorModeController::is_memory_planning() ||
+                       sim_control::SimulatorModeController::is_peak_attribution();
+    for (auto& e : events) {
+        if (e.size < 0) {  // free
+            auto callpath = ptr2callpath.find(e.ptr);
+            if (callpath != ptr2callpath.end()) {
+                auto static_tensor_cp = static_tensor_callpaths.find(callpath->second);
+                if (static_tensor_cp != static_tensor_callpaths.end()) {
+                    static_tensor_callpaths.erase(static_tensor_cp);
+                }
+                reclaimed_callpaths.emplace(callpath->second);
+                ptr2callpath.erase(callpath);
+            }
+            continue;
+        }
+        if (e.callpath == 0) {
+            continue;
+        }
+        auto hash = callpath_hashes.find(e.callpath);
+        if (hash == callpath_hashes.end()) {
+            if (texts.empty()) {
+                texts = tracer.get_callpaths();
+            }
+            hash = callpath_hashes.emplace(e.callpath, sha256(texts.at(e.callpath))).first;
+        }
+        auto& callpath = hash->second;
+        ptr2callpath.emplace(e.ptr, callpath);
+        // only read by the memory planner and the peak attribution
+        if (keep_op_ids) {
+            opid2callpath.emplace(e.op_id, callpath);
+        }
+
+        // static tensor analysis
+        // static tensors is the tensors that are at first iteration and never reclaimed in the later iterations
+        if (reclaimed_callpaths.find(callpath) == reclaimed_callpaths.end()) {
+            auto static_tensor_cp = static_tensor_callpaths.find(callpath);
+            bool first_iteration = iteration_boundaries.empty() || e.op_id < iteration_boundaries[0];
+            if (first_iteration) {
+                if (static_tensor_cp == static_tensor_callpaths.end()) {
+                    static_tensor_callpaths.emplace(callpath, std::make_pair(e.size, 1));
+                } else {
+                    static_tensor_cp->second.first += e.size;
+                    static_tensor_cp->second.second += 1;
+                }
+            } else {
+                if (static_tensor_cp != static_tensor_callpaths.end()) {
+                    static_tensor_cp->second.first += e.size;
+                    static_tensor_cp->second.second += 1;
+                }
+            }
+        }
+    }
+}
+
 void allocatorMgr::process_trace() {
+    flush_trace();
     // determine if process the active blocks
     if (!sim_control::SimulatorModeController::is_static_tensor_analysis()) {
         if (!_active_blocks.empty()) {
@@ -568,32 +850,715 @@ void allocatorMgr::process_trace() {
             increase_global_op_id();
         }
     }
-    for (auto t : _block_trace) {
-        opid2event.emplace(t.first, ALLOCATOR_MALLOC_BLOCK);
-        opid2event.emplace(t.second.first, ALLOCATOR_FREE_BLOCK);
+    if (sim_control::SimulatorModeController::is_trace_compression()) {
+        compress_trace();
+    }
+    if (sim_control::SimulatorModeController::is_trace_dumpping()) {
+        dump_trace();
+    }
+    compile_trace();
+}
+
+void allocatorMgr::dump_trace() {
+    auto path = fs::path(binary_trace_file_name).parent_path();
+    if (!fs::is_directory(path)) {
+        fs::create_directories(path);
+    }
+    binaryTraceWriter writer(binary_trace_file_name);
+    for_each_traced_block([&writer](op_id_t malloc_op_id, op_id_t free_op_id, size_t size) {
+        writer.add(malloc_op_id, free_op_id, size);
+    });
+    if (!writer.close()) {
+        std::cout << "[allocatorMgr::dump_trace()] cannot write " << binary_trace_file_name << std::endl;
+        return;
     }
+    std::cout << "[allocatorMgr::dump_trace()] " << writer.get_num_blocks() << " blocks, "
+              << format_size(writer.get_file_bytes()) << " to " << binary_trace_file_name << std::endl;
+}
 
-    for (auto t : _api_trace) {
-        opid2event.emplace(t.first, t.second);
+void allocatorMgr::compress_trace() {
+    // blocks of an earlier compression are encoded again with the new ones
+    compressed_trace.decode(_block_trace);
+    auto num_blocks = _block_trace.size();
+    compressed_trace.encode(_block_trace, iteration_boundaries);
+    trace_t().swap(_block_trace);
+
+    auto path = fs::path(compressed_trace_file_name).parent_path();
+    if (!fs::is_directory(path)) {
+        fs::create_directories(path);
     }
+    compressed_trace.dump(compressed_trace_file_name);
+    std::cout << "[allocatorMgr::compress_trace()] " << num_blocks << " blocks in "
+              << compressed_trace.get_num_iterations() << " iterations, "
+              << compressed_trace.get_num_patches() << " patches, "
+              << format_size(compressed_trace.get_memory_bytes()) << " in memory" << std::endl;
 }
 
-size_t allocatorMgr::simulate_allocator() {
-    for (auto op : opid2event) {
-        if (op.second == ALLOCATOR_MALLOC_BLOCK) {
-            auto orig_size = _block_trace[op.first].second;
-            auto block = this->alloc_sim.malloc(this->device, orig_size, this->stream);
-            free_blocks.emplace(_block_trace[op.first].first, block);
-        } else if (op.second == ALLOCATOR_FREE_BLOCK) {
-            this->alloc_sim.free(free_blocks[op.first]);
-        } else if (op.second == ALLOCATOR_EMPYT_CACHE) {
+void allocatorMgr::for_each_traced_block(const std::function<void(op_id_t, op_id_t, size_t)>& fn) {
+    // the compressed blocks are older than the ones traced since
+    compressed_trace.for_each_block(fn);
+    for (auto& t : _block_trace) {
+        fn(t.first, t.second.first, t.second.second);
+    }
+}
+
+void allocatorMgr::compile_trace() {
+    replay_slots.clear();
+    replay_slots.reserve(_block_trace.size() + compressed_trace.get_num_blocks());
+    for_each_traced_block([this](op_id_t malloc_op_id, op_id_t free_op_id, size_t size) {
+        replay_slots.emplace_back(malloc_op_id, free_op_id, size);
+    });
+    compile_events();
+}
+
+void allocatorMgr::compile_events() {
+    replay_events.clear();
+    auto num_blocks = replay_slots.size();
+    // the slots are indexed by uint32_t to keep ReplayEvent at 16 bytes, UINT32_MAX marks the API events
+    if (num_blocks >= std::numeric_limits<uint32_t>::max()) {
+        std::cout << "[allocatorMgr::compile_events()] " << num_blocks
+                  << " blocks overflow the 32-bit replay slot index" << std::endl;
+        exit(1);
+    }
+    replay_events.reserve(2 * num_blocks + _api_trace.size());
+    for (size_t i = 0; i < num_blocks; i++) {
+        auto& slot = replay_slots[i];
+        slot.block = nullptr;
+        slot.has_free_event = true;
+        slot.free_event = 0;
+        replay_events.emplace_back(slot.malloc_op_id, ALLOCATOR_MALLOC_BLOCK, static_cast<uint32_t>(i));
+        replay_events.emplace_back(slot.free_op_id, ALLOCATOR_FREE_BLOCK, static_cast<uint32_t>(i));
+    }
+    for (auto& t : _api_trace) {
+        replay_events.emplace_back(t.first, t.second, std::numeric_limits<uint32_t>::max());
+    }
+    std::stable_sort(replay_events.begin(), replay_events.end(),
+        [](const ReplayEvent& a, const ReplayEvent& b) { return a.op_id < b.op_id; });
+
+    // one event per op_id, the first one wins (e.g. the active blocks share the last op_id)
+    size_t count = 0;
+    for (size_t i = 0; i < replay_events.size(); i++) {
+        auto& e = replay_events[i];
+        if (count > 0 && replay_events[count - 1].op_id == e.op_id) {
+            if (e.type == ALLOCATOR_FREE_BLOCK) {
+                replay_slots[e.slot].has_free_event = false;
+            }
+            continue;
+        }
+        if (e.type == ALLOCATOR_FREE_BLOCK) {
+            replay_slots[e.slot].free_event = count;
+        }
+        replay_events[count++] = e;
+    }
+    replay_events.erase(replay_events.begin() + count, replay_events.end());
+
+    // detected by get_num_iterations() when the overhead is first estimated
+    num_iterations = 0;
+
+    steady_state.clear();
+    if (sim_control::SimulatorModeController::is_steady_state_detection()) {
+        // the iterations are the periods when their boundaries are known
+        size_t origin = 0;
+        size_t period_hint = 0;
+        if (iteration_boundaries.size() >= 2) {
+            auto event_of = [this](op_id_t op_id) -> size_t {
+                return std::lower_bound(replay_events.begin(), replay_events.end(), op_id,
+                    [](const ReplayEvent& e, op_id_t op_id) { return e.op_id < op_id; }) - replay_events.begin();
+            };
+            auto n = iteration_boundaries.size();
+            origin = event_of(iteration_boundaries[0]);
+            period_hint = event_of(iteration_boundaries[n - 1]) - event_of(iteration_boundaries[n - 2]);
+        }
+        steady_state.analyze(replay_events, replay_slots, origin, period_hint);
+    }
+}
+
+std::vector<PlanRequest> allocatorMgr::get_iteration_requests(size_t iter) {
+    std::vector<PlanRequest> requests;
+    if (iter >= iteration_boundaries.size()) {
+        return requests;
+    }
+    op_id_t start = (iter == 0) ? 0 : iteration_boundaries[iter - 1];
+    op_id_t end = iteration_boundaries[iter];
+
+    // replay_slots are sorted by malloc_op_id
+    auto it = std::lower_bound(replay_slots.begin(), replay_slots.end(), start,
+        [](const ReplaySlot& slot, op_id_t op_id) { return slot.malloc_op_id < op_id; });
+    for (; it != replay_slots.end() && it->malloc_op_id < end; ++it) {
+        auto callpath = opid2callpath.find(it->malloc_op_id);
+        // tensors living across the boundary are live until the iteration end
+        requests.emplace_back(
+            callpath != opid2callpath.end() ? callpath->second : "unknown",
+            it->malloc_op_id, std::min(it->free_op_id, end), it->size);
+    }
+    return requests;
+}
+
+void allocatorMgr::plan_static_memory() {
+    // skip the warm-up iteration if there are enough iterations
+    size_t plan_iteration = iteration_boundaries.size() > 1 ? 1 : 0;
+
+    allocatorPlanner planner;
+    planner.build_plan(get_iteration_requests(plan_iteration));
+    planner.dump_plan(plan_file_name);
+    std::cout << "[allocatorMgr::plan_static_memory()] iteration " << plan_iteration
+              << ", entries: " << planner.get_num_entries()
+              << ", arena size: " << planner.get_arena_size()
+              << " B (" << format_size(planner.get_arena_size()) << ")" << std::endl;
+
+    for (size_t i = plan_iteration + 1; i < iteration_boundaries.size(); i++) {
+        allocatorPlanner::report_validation(i, planner.validate(get_iteration_requests(i)));
+    }
+}
+
+void allocatorMgr::open_timeline() {
+    if (!sim_control::SimulatorModeController::is_timeline_exporting()) {
+        return;
+    }
+    auto path = fs::path(timeline_file_name).parent_path();
+    if (!fs::is_directory(path)) {
+        fs::create_directories(path);
+    }
+    timeline.reset(new allocatorTimeline(timeline_file_name));
+    alloc_sim.set_timeline(timeline.get());
+}
+
+void allocatorMgr::close_timeline() {
+    if (!timeline) {
+        return;
+    }
+    alloc_sim.set_timeline(nullptr);
+    timeline->close();
+    std::cout << "[allocatorMgr::close_timeline()] " << timeline->get_num_events()
+              << " events to " << timeline_file_name << std::endl;
+    timeline.reset();
+}
+
+void allocatorMgr::start_online_simulation() {
+    online_sim.reset(new allocatorOnlineSim());
+    // the current configs, the search starts from them
+    online_sim->add_instance(alloc_sim.get_sizing_params());
+    online_sim->start();
+    online_active.store(true, std::memory_order_release);
+}
+
+size_t allocatorMgr::finish_online_simulation() {
+    online_active.store(false, std::memory_order_release);
+    online_sim->sync();
+    online_sim->stop();
+    if (online_sim->get_num_dropped() > 0) {
+        std::cout << "[allocatorMgr::finish_online_simulation()] " << online_sim->get_num_dropped()
+                  << " events dropped on full buffers, the trace is replayed instead" << std::endl;
+        return std::numeric_limits<size_t>::max();
+    }
+    online_reserved_size = online_sim->get_max_reserved_bytes(0);
+    online_allocated_size = online_sim->get_max_allocated_bytes(0);
+    replay_op_counts = online_sim->get_op_counts(0);
+    replay_cost = ConfigCost{online_reserved_size, replay_op_counts.get_segment_ops(),
+                             online_sim->get_peak_fragmentation_bytes(0)};
+    std::cout << "[allocatorMgr::finish_online_simulation()] " << online_sim->get_num_processed()
+              << " events, max reserved size: " << online_reserved_size
+              << ", max allocated size: " << online_allocated_size << std::endl;
+    return online_reserved_size;
+}
+
+void allocatorMgr::log_original_configs() {
+    log_configs(original_configs);
+    // no initial replay if the online simulation already ran the current configs
+    if (online_reserved_size != 0 && original_configs.reserved_size == 0) {
+        original_configs.reserved_size = online_reserved_size;
+        original_configs.allocated_size = online_allocated_size;
+    }
+}
+
+void allocatorMgr::analyze_sensitivity() {
+    struct SensitivityEntry {
+        std::string parameter;
+        std::string value;
+        size_t allocated_size;
+        size_t reserved_size;
+        size_t max_num_segments;
+        double overhead_us;
+    };
+
+    // the configs are replayed side by side by an allocatorSearch, the baseline first
+    auto baseline = alloc_sim.get_sizing_params();
+    std::vector<SizingParams> candidates {baseline};
+    // <parameter, value, index of the candidate>, the baseline values all point to candidate 0
+    std::vector<std::tuple<std::string, std::string, size_t>> labels;
+    auto sweep = [&](const std::string& parameter, const std::set<size_t>& values, size_t SizingParams::*field) {
+        auto with_baseline = values;
+        with_baseline.insert(baseline.*field);
+        for (auto value : with_baseline) {
+            auto params = baseline;
+            params.*field = value;
+            if (params.kMinLargeAlloc >= params.kLargeBuffer) {
+                continue;
+            }
+            auto name = (value == std::numeric_limits<size_t>::max()) ? "max" : std::to_string(value);
+            if (value == baseline.*field) {
+                labels.emplace_back(parameter, name, 0);
+            } else {
+                labels.emplace_back(parameter, name, candidates.size());
+                candidates.push_back(params);
+            }
+        }
+    };
+    sweep("kMinBlockSize", kMinBlockSize_candidates, &SizingParams::kMinBlockSize);
+    sweep("kSmallSize", kSmallSize_candidates, &SizingParams::kSmallSize);
+    sweep("kSmallBuffer", kSmallBuffer_candidates, &SizingParams::kSmallBuffer);
+    sweep("kLargeBuffer", kLargeBuffer_candidates, &SizingParams::kLargeBuffer);
+    sweep("kMinLargeAlloc", kMinLargeAlloc_candidates, &SizingParams::kMinLargeAlloc);
+    sweep("kRoundLarge", kRoundLarge_candidates, &SizingParams::kRoundLarge);
+    sweep("m_max_split_size", max_split_size_candidates, &SizingParams::max_split_size);
+
+    auto applied_groups = alloc_sim.get_group_enable_flag_sim() ? allocatorConf::_GROUPS : std::vector<size_t>();
+    allocatorSearch search(device, stream, replay_events, replay_slots, steady_state, applied_groups, candidates);
+    search.start();
+    search.wait();
+
+    std::vector<SensitivityEntry> entries;
+    for (auto& l : labels) {
+        auto& result = search.get_candidate(std::get<2>(l));
+        entries.push_back(SensitivityEntry{std::get<0>(l), std::get<1>(l), result.allocated_size,
+                                           result.reserved_size, result.max_num_segments,
+                                           get_overhead_us(result.op_counts)});
+    }
+    auto& base = search.get_candidate(0);
+
+    // the groups are global, so the differences are replayed one by one on alloc_sim
+    auto groups = allocatorConf::_GROUPS;
+    entries.push_back(SensitivityEntry{"group_difference", "none", base.allocated_size,
+                                       base.reserved_size, base.max_num_segments,
+                                       get_overhead_us(base.op_counts)});
+    auto replay_groups = [&](const std::string& value) {
+        simulate_allocator();
+        entries.push_back(SensitivityEntry{"group_difference", value, get_max_allocated_bytes(),
+                                           get_max_reserved_bytes(), alloc_sim.get_max_num_segments(),
+                                           get_overhead_us(replay_op_counts)});
+    };
+    for (auto diff : GROUP_DIFFERENCES) {
+        empty_cache();
+        reset_allocator_memory_usage();
+        group_blocks(diff);
+        std::ostringstream value;
+        value << diff;
+        replay_groups(value.str());
+    }
+    // the groups the config search uses
+    for (auto num_groups : GROUP_COUNTS) {
+        empty_cache();
+        reset_allocator_memory_usage();
+        auto num_sizes = group_blocks_by_waste(num_groups);
+        if (num_sizes == 0) {
+            break;
+        }
+        replay_groups("by_waste_" + std::to_string(num_groups));
+        if (num_groups >= num_sizes) {
+            break;
+        }
+    }
+    // replay the baseline again, log_original_configs() reads its peaks
+    allocatorConf::_GROUPS = groups;
+    alloc_sim.set_group_enable_flag_sim(group_enable_flag);
+    empty_cache();
+    reset_allocator_memory_usage();
+    simulate_allocator();
+
+    auto path = fs::path(sensitivity_file_name).parent_path();
+    if (!fs::is_directory(path)) {
+        fs::create_directories(path);
+    }
+    std::ofstream csv(sensitivity_file_name);
+    csv << "parameter,value,reserved_bytes,reserved_delta,allocated_bytes,max_segments,overhead_us" << std::endl;
+    // <spread of the reserved sizes, parameter>
+    std::map<std::string, std::pair<size_t, size_t>> ranges;
+    for (auto& e : entries) {
+        auto delta = static_cast<int64_t>(e.reserved_size) - static_cast<int64_t>(base.reserved_size);
+        csv << e.parameter << "," << e.value << "," << e.reserved_size << "," << delta << ","
+            << e.allocated_size << "," << e.max_num_segments << "," << e.overhead_us << std::endl;
+        auto range = ranges.emplace(e.parameter, std::make_pair(e.reserved_size, e.reserved_size)).first;
+        range->second.first = std::min(range->second.first, e.reserved_size);
+        range->second.second = std::max(range->second.second, e.reserved_size);
+    }
+    csv.close();
+
+    std::vector<std::pair<size_t, std::string>> spreads;
+    for (auto& r : ranges) {
+        spreads.emplace_back(r.second.second - r.second.first, r.first);
+    }
+    std::sort(spreads.rbegin(), spreads.rend());
+
+    int width = 36;
+    std::cout << "[allocatorMgr::analyze_sensitivity()] baseline reserved " << format_size(base.reserved_size)
+              << ", " << base.max_num_segments << " segments, " << entries.size() << " values to "
+              << sensitivity_file_name << std::endl;
+    for (auto& s : spreads) {
+        std::cout << std::setw(width) << std::left << s.second + ": " << "reserved spread "
+                  << format_size(s.first) << std::endl;
+    }
+}
+
+WorkloadSignature allocatorMgr::get_workload_signature() {
+    // replay_slots are sorted by malloc_op_id
+    auto first_slot = [this](op_id_t op_id) {
+        return std::lower_bound(replay_slots.begin(), replay_slots.end(), op_id,
+            [](const ReplaySlot& slot, op_id_t op_id) { return slot.malloc_op_id < op_id; });
+    };
+    std::vector<size_t> sizes;
+    auto n = iteration_boundaries.size();
+    if (n > 0) {
+        // the first iteration warms up, the last one is the steady state
+        auto begin = first_slot(n >= 2 ? iteration_boundaries[n - 2] : 0);
+        auto end = first_slot(iteration_boundaries[n - 1]);
+        for (auto it = begin; it != end; ++it) {
+            sizes.push_back(it->size);
+        }
+    } else {
+        for (auto& slot : replay_slots) {
+            sizes.push_back(slot.size);
+        }
+        auto period = compressedTrace::detect_period(sizes);
+        if (period > 0 && period < sizes.size()) {
+            sizes.erase(sizes.begin(), sizes.end() - period);
+        }
+    }
+    return WorkloadSignature::from_sizes(sizes);
+}
+
+std::string allocatorMgr::get_search_objective() const {
+    std::ostringstream objective;
+    objective << "segment_op_bytes=" << search_tradeoff.segment_op_bytes
+              << ",fragmentation_weight=" << search_tradeoff.fragmentation_weight
+              << ",latency=" << latency_model.segment_alloc_us << "/" << latency_model.segment_alloc_us_per_mb
+              << "/" << latency_model.segment_release_us << "/" << latency_model.segment_release_us_per_mb
+              << "/" << latency_model.cache_flush_us << "/" << latency_model.pool_lookup_us;
+    return objective.str();
+}
+
+void allocatorMgr::lookup_config_store(const std::string& search_mode) {
+    search_candidates = ALL_CANDIDATES;
+    search_group_counts = GROUP_COUNTS;
+    warm_start.clear();
+    num_evaluated = 0;
+    search_start = std::chrono::steady_clock::now();
+    if (!sim_control::SimulatorModeController::is_config_store()) {
+        return;
+    }
+
+    auto signature = get_workload_signature();
+    configStore store(config_store_directory);
+    StoredConfigs stored;
+    double similarity = 0.0;
+    if (!store.find(signature, search_mode, get_search_objective(), MIN_WARM_START_SIMILARITY, stored, similarity)) {
+        std::cout << "[allocatorMgr::lookup_config_store()] no stored " << search_mode << " configs for "
+                  << signature.hash << std::endl;
+        return;
+    }
+    warm_start = stored.signature.hash;
+    if (stored.signature.hash == signature.hash) {
+        // the same workload, the stored result is replayed instead of searched
+        for (size_t i = 0; i < CONFIG_NUMS; i++) {
+            search_candidates[i] = {stored.configs[i]};
+        }
+        search_group_counts.clear();
+        if (!stored.groups.empty()) {
+            search_group_counts.insert(stored.groups.size());
+        }
+        std::cout << "[allocatorMgr::lookup_config_store()] reuse the configs of " << signature.hash
+                  << ", searched in " << stored.search_seconds << " s over "
+                  << stored.num_evaluated << " configs" << std::endl;
+        return;
+    }
+
+    // the stored value and its neighbours on the grid
+    auto neighbours = [](const std::set<size_t>& candidates, size_t value) {
+        std::set<size_t> near {value};
+        auto it = candidates.lower_bound(value);
+        if (it != candidates.begin()) {
+            near.insert(*std::prev(it));
+        }
+        if (it != candidates.end() && *it == value) {
+            it++;
+        }
+        if (it != candidates.end()) {
+            near.insert(*it);
+        }
+        return near;
+    };
+    for (size_t i = 0; i < CONFIG_NUMS; i++) {
+        search_candidates[i] = neighbours(ALL_CANDIDATES[i], stored.configs[i]);
+    }
+    search_group_counts = neighbours(GROUP_COUNTS, stored.groups.size());
+    search_group_counts.erase(0);
+    std::cout << "[allocatorMgr::lookup_config_store()] warm-start from the configs of " << stored.signature.hash
+              << ", similarity " << similarity << std::endl;
+}
+
+void allocatorMgr::save_config_store(const std::string& search_mode) {
+    if (!sim_control::SimulatorModeController::is_config_store()) {
+        return;
+    }
+    StoredConfigs entry;
+    entry.signature = get_workload_signature();
+    if (entry.signature.hash == warm_start) {
+        return;
+    }
+    for (size_t i = 0; i < CONFIG_NUMS; i++) {
+        entry.configs[i] = allocatorConf::get_funcs[i]();
+    }
+    if (alloc_sim.get_group_enable_flag_sim()) {
+        entry.groups = allocatorConf::_GROUPS;
+    }
+    entry.allocated_size = searched_configs.allocated_size;
+    entry.reserved_size = searched_configs.reserved_size;
+    entry.overhead_us = searched_configs.overhead_us;
+    entry.search_mode = search_mode;
+    entry.objective = get_search_objective();
+    entry.num_evaluated = num_evaluated;
+    entry.search_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - search_start).count();
+    entry.warm_start = warm_start;
+    entry.created = static_cast<long long>(std::time(nullptr));
+
+    std::string error;
+    configStore store(config_store_directory);
+    if (!store.save(entry, error)) {
+        std::cout << "[allocatorMgr::save_config_store()] " << error << std::endl;
+        return;
+    }
+    std::cout << "[allocatorMgr::save_config_store()] " << entry.signature.hash << " in "
+              << config_store_directory << std::endl;
+}
+
+void allocatorMgr::start_background_search() {
+    log_configs(original_configs, false);
+
+    // the current configs first, a candidate has to be strictly better to win
+    std::vector<SizingParams> candidates;
+    auto params = alloc_sim.get_sizing_params();
+    candidates.push_back(params);
+    for (auto kMinBlockSize : kMinBlockSize_candidates) {
+        for (auto kSmallSize : kSmallSize_candidates) {
+            for (auto kSmallBuffer : kSmallBuffer_candidates) {
+                for (auto kLargeBuffer : kLargeBuffer_candidates) {
+                    for (auto kMinLargeAlloc : kMinLargeAlloc_candidates) {
+                        for (auto kRoundLarge : kRoundLarge_candidates) {
+                            Configs configs(kMinBlockSize, kSmallSize, kSmallBuffer,
+                                            kLargeBuffer, kMinLargeAlloc, kRoundLarge, 0, 0);
+                            if (!check_configs(configs)) {
+                                continue;
+                            }
+                            params.kMinBlockSize = kMinBlockSize;
+                            params.kSmallSize = kSmallSize;
+                            params.kSmallBuffer = kSmallBuffer;
+                            params.kLargeBuffer = kLargeBuffer;
+                            params.kMinLargeAlloc = kMinLargeAlloc;
+                            params.kRoundLarge = kRoundLarge;
+                            candidates.push_back(params);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    auto applied_groups = alloc_sim.get_group_enable_flag_sim() ? allocatorConf::_GROUPS : std::vector<size_t>();
+    background_search.reset(new allocatorSearch(device, stream, replay_events, replay_slots,
+                                                steady_state, applied_groups, candidates));
+    background_search->start();
+    std::cout << "[allocatorMgr::start_background_search()] " << candidates.size()
+              << " candidates" << std::endl;
+}
+
+void allocatorMgr::apply_background_search() {
+    auto& current = background_search->get_candidate(0);
+    original_configs.allocated_size = current.allocated_size;
+    original_configs.reserved_size = current.reserved_size;
+    original_configs.overhead_us = get_overhead_us(current.op_counts);
+
+    auto& best = background_search->get_best(search_tradeoff);
+    searched_configs = Configs(
+        best.params.kMinBlockSize,
+        best.params.kSmallSize,
+        best.params.kSmallBuffer,
+        best.params.kLargeBuffer,
+        best.params.kMinLargeAlloc,
+        best.params.kRoundLarge,
+        best.allocated_size,
+        best.reserved_size
+    );
+    searched_configs.overhead_us = get_overhead_us(best.op_counts);
+    current_reserved_size = best.reserved_size;
+    current_cost = search_tradeoff.cost(best.get_cost());
+    apply_configs(searched_configs);
+    std::cout << "[allocatorMgr::apply_background_search()] at iteration " << iteration << std::endl;
+    report_configs(original_configs, searched_configs);
+    for (size_t i = 0; i < background_search->get_progress().second; i++) {
+        auto& c = background_search->get_candidate(i);
+        auto configs = Configs(c.params.kMinBlockSize, c.params.kSmallSize, c.params.kSmallBuffer,
+                               c.params.kLargeBuffer, c.params.kMinLargeAlloc, c.params.kRoundLarge,
+                               c.allocated_size, c.reserved_size);
+        configs.overhead_us = get_overhead_us(c.op_counts);
+        // the groups the search replayed, not the ones applied since
+        pareto_front.insert(c.get_cost(), std::make_pair(configs, background_search->get_groups()));
+    }
+    replay_cost = best.get_cost();
+    report_pareto_front();
+    dump_opt_guidance(dump_file_name);
+    background_search.reset();
+    configs_searched = true;
+}
+
+std::pair<size_t, size_t> allocatorMgr::get_search_progress() {
+    if (!background_search) {
+        return std::make_pair(0, 0);
+    }
+    return background_search->get_progress();
+}
+
+bool allocatorMgr::get_searched_configs(Configs& configs) {
+    if (background_search || !configs_searched) {
+        return false;   // still running, or no search has run
+    }
+    configs = searched_configs;
+    return true;
+}
+
+PeakAttribution allocatorMgr::capture_live_blocks(op_id_t op_id) {
+    PeakAttribution peak;
+    peak.op_id = op_id;
+    std::tie(peak.cached_small_bytes, peak.cached_large_bytes) = alloc_sim.get_cached_bytes();
+
+    std::tie(peak.allocated_bytes, peak.reserved_bytes) = alloc_sim.get_current_memory_usage();
+
+    // the blocks allocated and not yet freed at op_id, including the ones whose free event was dropped
+    for (auto& slot : replay_slots) {
+        if (slot.block == nullptr) {
+            continue;
+        }
+        auto callpath = opid2callpath.find(slot.malloc_op_id);
+        auto key = (callpath != opid2callpath.end()) ? callpath->second
+                                                      : "size_" + std::to_string(slot.size);
+        auto& usage = peak.callpaths[key];
+        usage.bytes += slot.block->size;
+        usage.requested_bytes += slot.size;
+        usage.num_blocks++;
+    }
+    return peak;
+}
+
+void allocatorMgr::attribute_peak_memory() {
+    // first replay finds the peaks
+    simulate_allocator();
+    op_id_t allocated_op_id, reserved_op_id;
+    std::tie(allocated_op_id, reserved_op_id) = alloc_sim.get_peak_op_ids();
+    empty_cache();
+    reset_allocator_memory_usage();
+
+    PeakAttribution allocated_peak, reserved_peak;
+    simulate_allocator([&](op_id_t op_id) {
+        if (op_id == allocated_op_id) {
+            allocated_peak = capture_live_blocks(op_id);
+        }
+        if (op_id == reserved_op_id) {
+            reserved_peak = capture_live_blocks(op_id);
+        }
+    });
+    empty_cache();
+    reset_allocator_memory_usage();
+
+    auto path = fs::path(peak_file_name).parent_path();
+    if (!fs::is_directory(path)) {
+        fs::create_directories(path);
+    }
+    std::ofstream(peak_file_name).close();
+    report_peak_attribution("reserved peak", reserved_peak);
+    report_peak_attribution("allocated peak", allocated_peak);
+}
+
+void allocatorMgr::report_peak_attribution(const std::string& title, const PeakAttribution& peak) {
+    std::vector<std::pair<std::string, CallpathUsage>> usages(peak.callpaths.begin(), peak.callpaths.end());
+    std::sort(usages.begin(), usages.end(), [](const std::pair<std::string, CallpathUsage>& a,
+                                               const std::pair<std::string, CallpathUsage>& b) {
+        return a.second.bytes > b.second.bytes;
+    });
+
+    std::ofstream output(peak_file_name, std::ios::app);
+    output << "# " << title << " op_id: " << peak.op_id
+           << " reserved: " << peak.reserved_bytes
+           << " allocated: " << peak.allocated_bytes
+           << " cached_small: " << peak.cached_small_bytes
+           << " cached_large: " << peak.cached_large_bytes << std::endl;
+    output << "# <callpath> <bytes> <requested_bytes> <num_blocks>" << std::endl;
+    for (auto& u : usages) {
+        output << u.first << " " << u.second.bytes << " " << u.second.requested_bytes
+               << " " << u.second.num_blocks << std::endl;
+    }
+    output.close();
+
+    size_t max_report = 10;
+    std::cout << "[allocatorMgr::report_peak_attribution()] " << title << " at op_id " << peak.op_id
+              << ": reserved " << format_size(peak.reserved_bytes)
+              << ", allocated " << format_size(peak.allocated_bytes)
+              << ", cached small pool " << format_size(peak.cached_small_bytes)
+              << ", cached large pool " << format_size(peak.cached_large_bytes) << std::endl;
+    for (size_t i = 0; i < usages.size() && i < max_report; i++) {
+        std::cout << "  " << usages[i].first << ": " << format_size(usages[i].second.bytes)
+                  << " in " << usages[i].second.num_blocks << " blocks" << std::endl;
+    }
+}
+
+size_t allocatorMgr::simulate_allocator(const std::function<void(op_id_t)>& on_op) {
+    // the releases of the empty_cache() before the replay are not its own
+    auto op_counts = alloc_sim.get_op_counts();
+    // the skipped periods would miss the callbacks and the timeline events
+    std::unique_ptr<steadyStateReplay> steady;
+    if (steady_state.is_periodic() && !on_op && !timeline) {
+        steady.reset(new steadyStateReplay(steady_state, replay_events, replay_slots));
+    }
+    // a slot holds its block only between its malloc and free in this replay
+    for (auto& slot : replay_slots) {
+        slot.block = nullptr;
+    }
+    auto block_of = [this](uint32_t slot) -> Block*& { return replay_slots[slot].block; };
+    for (size_t i = 0; i < replay_events.size(); i++) {
+        if (steady && steady_state.is_boundary(i)) {
+            i = steady->on_boundary(i, alloc_sim, block_of);
+        }
+        auto& e = replay_events[i];
+        alloc_sim.set_op_id(e.op_id);
+        if (e.type == ALLOCATOR_MALLOC_BLOCK) {
+            auto& slot = replay_slots[e.slot];
+            slot.block = this->alloc_sim.malloc(this->device, slot.size, this->stream);
+            if (steady) {
+                steady->on_malloc(e.slot);
+            }
+        } else if (e.type == ALLOCATOR_FREE_BLOCK) {
+            auto& slot = replay_slots[e.slot];
+            this->alloc_sim.free(slot.block);
+            slot.block = nullptr;
+            if (steady) {
+                steady->on_free(e.slot);
+            }
+        } else if (e.type == ALLOCATOR_EMPYT_CACHE) {
             empty_cache();
         }
+        if (on_op) {
+            on_op(e.op_id);
+        }
+    }
+    for (auto& slot : replay_slots) {
+        slot.block = nullptr;
     }
-    free_blocks.clear();
 
     auto reserved_size = get_max_reserved_bytes();
     auto allocated_size = get_max_allocated_bytes();
+    replay_op_counts = alloc_sim.get_op_counts() - op_counts;
+    if (steady) {
+        replay_op_counts += steady->get_skipped_op_counts();
+    }
+    replay_cost = ConfigCost{reserved_size, replay_op_counts.get_segment_ops(),
+                             alloc_sim.get_peak_fragmentation_bytes()};
 
     log_configs(searched_configs);
     allocator_assert(reserved_size >= allocated_size);
@@ -614,6 +1579,8 @@ void allocatorMgr::report_configs(const Configs& conf_before, const Configs& con
               << static_cast<int64_t>(conf_after.reserved_size) << " diff: "
               << static_cast<int64_t>(conf_before.reserved_size - conf_after.reserved_size)
               << std::endl;
+    std::cout << std::setw(width) << std::left << "Allocator overhead (us/iter): "
+              << conf_before.overhead_us << " => " << conf_after.overhead_us << std::endl;
     std::cout << std::setw(width) << std::left << "kMinBlockSize: " << conf_before.kMinBlockSize << " => "
               << conf_after.kMinBlockSize << std::endl;
     std::cout << std::setw(width) << std::left << "kSmallSize: " << conf_before.kSmallSize << " => "
@@ -644,7 +1611,7 @@ void allocatorMgr::report_configs(const Configs& conf_before, const Configs& con
               << conf_before.m_memory_segment_address_interval << " => "
               << conf_after.m_memory_segment_address_interval << std::endl;
     if (group_enable_flag) {
-        std::cout << "Group difference: " << current_difference << std::endl;
+        std::cout << "Groups: ";
         for (auto g : allocatorConf::_GROUPS) {
             std::cout << g << " ";
         }
@@ -698,9 +1665,9 @@ void allocatorMgr::show_allocator_memory_usage() {
 
 void allocatorMgr::group_blocks(const float& difference) {
     std::set<size_t> block_sizes;
-    for (auto t : _block_trace) {
-        if (t.second.second > allocatorConf::get_kLargeBuffer()) {
-            block_sizes.insert(t.second.second);
+    for (auto& slot : replay_slots) {
+        if (slot.size > allocatorConf::get_kLargeBuffer()) {
+            block_sizes.insert(slot.size);
         }
     }
 
@@ -708,72 +1675,44 @@ void allocatorMgr::group_blocks(const float& difference) {
         return;
     }
 
-    for (int i = 0; i < GROUP_NUMS; i++) {
-        allocatorConf::_GROUPS[i] = std::numeric_limits<size_t>::max();
-    }
+    allocatorConf::_GROUPS.clear();
     size_t small_group_size = *block_sizes.begin();
-    size_t group_boundary = 0;
-    int index = 0;
-    for (auto it = block_sizes.begin(); it != block_sizes.end();) {
+    for (auto it = block_sizes.begin(); it != block_sizes.end(); it++) {
         if ((*it - small_group_size) / small_group_size > difference) {
-            group_boundary = *std::prev(it);
-            allocatorConf::_GROUPS[index] =group_boundary;
-            index++;
+            allocatorConf::_GROUPS.push_back(*std::prev(it));
             small_group_size = *it;
-            if (index == GROUP_NUMS-1) {
-                allocatorConf::_GROUPS[index] = *block_sizes.rbegin();
-                index++;
-                break;
-            }
         }
-        it++;
     }
-    if (group_boundary != *block_sizes.rbegin()) {
-        allocatorConf::_GROUPS[index] = *block_sizes.rbegin();
+    allocatorConf::_GROUPS.push_back(*block_sizes.rbegin());
+    alloc_sim.set_group_enable_flag_sim(true);
+}
+
+size_t allocatorMgr::group_blocks_by_waste(size_t num_groups) {
+    // the sizes are grouped as get_allocation_size() sees them, rounded to kMinBlockSize
+    auto min_block_size = allocatorConf::get_kMinBlockSize();
+    sizeGrouper grouper;
+    for (auto& slot : replay_slots) {
+        auto size = min_block_size * ((std::max<size_t>(slot.size, 1) + min_block_size - 1) / min_block_size);
+        if (size > allocatorConf::get_kLargeBuffer()) {
+            grouper.add(size);
+        }
     }
+    if (grouper.get_num_sizes() == 0) {
+        return 0;
+    }
+
+    allocatorConf::_GROUPS = grouper.partition(num_groups);
     alloc_sim.set_group_enable_flag_sim(true);
+    return grouper.get_num_sizes();
 }
 
 size_t allocatorMgr::get_grouped_allocation_size(size_t size) {
-    if (size < allocatorConf::_GROUPS[0]) {
-        if (allocatorConf::_GROUPS[0] != std::numeric_limits<size_t>::max()) {
-            return allocatorConf::_GROUPS[0];
-        } else {
-            auto tunablekRoundLarge = AllocatorSim::allocatorConf::get_kRoundLarge();
-            return tunablekRoundLarge * ((size + tunablekRoundLarge - 1) / tunablekRoundLarge);
-        }
-    } else if (size < allocatorConf::_GROUPS[1]) {
-        if (allocatorConf::_GROUPS[1] != std::numeric_limits<size_t>::max()) {
-            return allocatorConf::_GROUPS[1];
-        } else {
-            auto tunablekRoundLarge = AllocatorSim::allocatorConf::get_kRoundLarge();
-            return tunablekRoundLarge * ((size + tunablekRoundLarge - 1) / tunablekRoundLarge);
-        }
-    } else if (size < allocatorConf::_GROUPS[2]) {
-        if (allocatorConf::_GROUPS[2] != std::numeric_limits<size_t>::max()) {
-            return allocatorConf::_GROUPS[2];
-        } else {
-            auto tunablekRoundLarge = AllocatorSim::allocatorConf::get_kRoundLarge();
-            return tunablekRoundLarge * ((size + tunablekRoundLarge - 1) / tunablekRoundLarge);
-        }
-    } else if (size < allocatorConf::_GROUPS[3]) {
-        if (allocatorConf::_GROUPS[3] != std::numeric_limits<size_t>::max()) {
-            return allocatorConf::_GROUPS[3];
-        } else {
-            auto tunablekRoundLarge = AllocatorSim::allocatorConf::get_kRoundLarge();
-            return tunablekRoundLarge * ((size + tunablekRoundLarge - 1) / tunablekRoundLarge);
-        }
-    } else if (size < allocatorConf::_GROUPS[4]) {
-        if (allocatorConf::_GROUPS[4] != std::numeric_limits<size_t>::max()) {
-            return allocatorConf::_GROUPS[4];
-        } else {
-            auto tunablekRoundLarge = AllocatorSim::allocatorConf::get_kRoundLarge();
-            return tunablekRoundLarge * ((size + tunablekRoundLarge - 1) / tunablekRoundLarge);
-        }
-    } else {
-        auto tunablekRoundLarge = AllocatorSim::allocatorConf::get_kRoundLarge();
-        return tunablekRoundLarge * ((size + tunablekRoundLarge - 1) / tunablekRoundLarge);
+    auto group_size = allocatorConf::get_group_size(size);
+    if (group_size) {
+        return group_size;
     }
+    auto tunablekRoundLarge = AllocatorSim::allocatorConf::get_kRoundLarge();
+    return tunablekRoundLarge * ((size + tunablekRoundLarge - 1) / tunablekRoundLarge);
 }
 
 size_t allocatorMgr::get_allocation_size(size_t size) {
@@ -798,6 +1737,10 @@ std::string allocatorMgr::get_callpath_hash() {
     // return python_states + cpp_callpath;
 }
 
+std::string allocatorMgr::get_callpath() {
+    return get_python_states() + get_backtrace();
+}
+
 std::string allocatorMgr::get_python_states() {
     size_t num_states = 0;
 
@@ -0,0 +1,160 @@
+#include "allocator_online.h"
+
+#include <cassert>
+
+namespace c10 {
+namespace cuda {
+namespace AllocatorSim {
+
+namespace {
+    // the worker drains the buffers at least this often, push() does not wake it
+    const auto ONLINE_DRAIN_INTERVAL = std::chrono::milliseconds(1);
+
+    const int ONLINE_DEVICE = 0;
+    const int ONLINE_STREAM = 0;
+}   // anonymous namespace for variables
+
+allocatorOnlineSim::allocatorOnlineSim(size_t num_preallocated_chunks, size_t max_pending_chunks)
+    : tracer(num_preallocated_chunks, max_pending_chunks) {
+}
+
+allocatorOnlineSim::~allocatorOnlineSim() {
+    stop();
+}
+
+void allocatorOnlineSim::add_instance(const SizingParams& params) {
+    assert(!is_running());
+    instances.emplace_back(new OnlineInstance());
+    instances.back()->sim.pin_configs(params);
+}
+
+void allocatorOnlineSim::start() {
+    if (is_running()) {
+        return;
+    }
+    stopping = false;
+    worker = std::thread(&allocatorOnlineSim::run, this);
+}
+
+void allocatorOnlineSim::stop() {
+    if (!is_running()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> guard(state_mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+bool allocatorOnlineSim::is_running() const {
+    return worker.joinable();
+}
+
+op_id_t allocatorOnlineSim::push(void* ptr, int64_t size) {
+    auto op_id = next_global_op_id();
+    tracer.append(op_id, ptr, size);
+    return op_id;
+}
+
+op_id_t allocatorOnlineSim::push_empty_cache() {
+    return push(nullptr, 0);
+}
+
+void allocatorOnlineSim::run() {
+    while (true) {
+        uint64_t request;
+        bool last;
+        {
+            std::unique_lock<std::mutex> lock(state_mutex);
+            wake.wait_for(lock, ONLINE_DRAIN_INTERVAL,
+                [this] { return stopping || sync_requested > sync_done; });
+            request = sync_requested;
+            last = stopping;
+        }
+
+        // sees every event published before the request
+        auto events = tracer.drain();
+        for (auto& event : events) {
+            process(event);
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(state_mutex);
+            num_processed += events.size();
+            sync_done = request;
+        }
+        drained.notify_all();
+        if (last) {
+            return;     // stopping and drained
+        }
+    }
+}
+
+void allocatorOnlineSim::process(const TraceEvent& event) {
+    for (auto& instance : instances) {
+        auto& sim = instance->sim;
+        sim.set_op_id(event.op_id);
+        if (event.size > 0) {  // malloc
+            auto block = sim.malloc(ONLINE_DEVICE, event.size, ONLINE_STREAM);
+            instance->live_blocks[event.ptr] = block;
+        } else if (event.size < 0) {  // free
+            auto b = instance->live_blocks.find(event.ptr);
+            if (b == instance->live_blocks.end()) {
+                continue;   // allocated before the simulation started
+            }
+            sim.free(b->second);
+            instance->live_blocks.erase(b);
+        } else {
+            sim.empty_cache();
+        }
+    }
+}
+
+void allocatorOnlineSim::sync() {
+    if (!is_running()) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(state_mutex);
+    auto target = ++sync_requested;
+    wake.notify_one();
+    drained.wait(lock, [this, target] { return sync_done >= target; });
+}
+
+size_t allocatorOnlineSim::get_num_instances() const {
+    return instances.size();
+}
+
+const SizingParams& allocatorOnlineSim::get_sizing_params(size_t i) const {
+    return instances[i]->sim.get_sizing_params();
+}
+
+size_t allocatorOnlineSim::get_max_reserved_bytes(size_t i) {
+    return instances[i]->sim.get_max_reserved_bytes();
+}
+
+size_t allocatorOnlineSim::get_max_allocated_bytes(size_t i) {
+    return instances[i]->sim.get_max_allocated_bytes();
+}
+
+const AllocatorOpCounts& allocatorOnlineSim::get_op_counts(size_t i) {
+    return instances[i]->sim.get_op_counts();
+}
+
+size_t allocatorOnlineSim::get_peak_fragmentation_bytes(size_t i) {
+    return instances[i]->sim.get_peak_fragmentation_bytes();
+}
+
+uint64_t allocatorOnlineSim::get_num_processed() {
+    std::lock_guard<std::mutex> guard(state_mutex);
+    return num_processed;
+}
+
+uint64_t allocatorOnlineSim::get_num_dropped() const {
+    return tracer.get_num_dropped();
+}
+
+}  // namespace AllocatorSim
+}  // namespace cuda
+}  // namespace c10
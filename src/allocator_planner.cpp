@@ -0,0 +1,206 @@
+#include "allocator_planner.h"
+#include "allocator_config.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+namespace c10 {
+namespace cuda {
+namespace AllocatorSim {
+
+namespace {
+
+size_t round_plan_size(size_t size) {
+    auto min_block_size = allocatorConf::get_kMinBlockSize();
+    return min_block_size * ((size + min_block_size - 1) / min_block_size);
+}
+
+bool compare_malloc_op(const PlanRequest& a, const PlanRequest& b) {
+    return a.malloc_op_id < b.malloc_op_id;
+}
+
+}  // anonymous namespace for helpers
+
+std::vector<plan_key_t> allocatorPlanner::make_keys(const std::vector<PlanRequest>& requests) {
+    std::vector<plan_key_t> keys;
+    keys.reserve(requests.size());
+    std::unordered_map<std::string, size_t> occurrences;
+    for (auto& r : requests) {
+        keys.emplace_back(r.callpath, occurrences[r.callpath]++);
+    }
+    return keys;
+}
+
+void allocatorPlanner::build_plan(std::vector<PlanRequest> requests) {
+    plan.clear();
+    arena_size = 0;
+
+    std::sort(requests.begin(), requests.end(), compare_malloc_op);
+    auto keys = make_keys(requests);
+
+    // place the largest tensors first
+    std::vector<size_t> order(requests.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&requests](size_t a, size_t b) {
+        return requests[a].size > requests[b].size;
+    });
+
+    // <offset, index> of placed requests
+    std::vector<std::pair<size_t, size_t>> placed;
+    std::vector<size_t> offsets(requests.size(), 0);
+    std::vector<std::pair<size_t, size_t>> conflicts;
+    for (auto i : order) {
+        auto& r = requests[i];
+        auto size = round_plan_size(r.size);
+
+        conflicts.clear();
+        for (auto& p : placed) {
+            auto& other = requests[p.second];
+            if (r.malloc_op_id < other.free_op_id && other.malloc_op_id < r.free_op_id) {
+                conflicts.emplace_back(p.first, round_plan_size(other.size));
+            }
+        }
+        std::sort(conflicts.begin(), conflicts.end());
+
+        // best fit among the gaps left by the live-range conflicts
+        size_t best_offset = std::numeric_limits<size_t>::max();
+        size_t best_gap = std::numeric_limits<size_t>::max();
+        size_t prev_end = 0;
+        for (auto& c : conflicts) {
+            if (c.first > prev_end) {
+                auto gap = c.first - prev_end;
+                if (gap >= size && gap < best_gap) {
+                    best_gap = gap;
+                    best_offset = prev_end;
+                }
+            }
+            prev_end = std::max(prev_end, c.first + c.second);
+        }
+        if (best_offset == std::numeric_limits<size_t>::max()) {
+            best_offset = prev_end;
+        }
+
+        offsets[i] = best_offset;
+        placed.emplace_back(best_offset, i);
+        arena_size = std::max(arena_size, best_offset + size);
+    }
+
+    for (size_t i = 0; i < requests.size(); i++) {
+        plan.emplace(keys[i], PlanEntry(offsets[i], round_plan_size(requests[i].size)));
+    }
+}
+
+PlanValidation allocatorPlanner::validate(std::vector<PlanRequest> requests) const {
+    PlanValidation result;
+
+    std::sort(requests.begin(), requests.end(), compare_malloc_op);
+    auto keys = make_keys(requests);
+
+    // <op_id, <is_malloc, index>>
+    std::vector<std::pair<op_id_t, std::pair<bool, size_t>>> events;
+    std::vector<const PlanEntry*> entries(requests.size(), nullptr);
+    for (size_t i = 0; i < requests.size(); i++) {
+        result.num_allocations++;
+        auto it = plan.find(keys[i]);
+        if (it == plan.end()) {
+            result.num_unplanned++;
+            continue;
+        }
+        if (round_plan_size(requests[i].size) > it->second.size) {
+            result.num_oversized++;
+            continue;
+        }
+        entries[i] = &it->second;
+        events.emplace_back(requests[i].malloc_op_id, std::make_pair(true, i));
+        events.emplace_back(requests[i].free_op_id, std::make_pair(false, i));
+    }
+    std::sort(events.begin(), events.end());
+
+    // <offset, end> of live planned slots
+    std::multimap<size_t, size_t> live;
+    std::vector<std::multimap<size_t, size_t>::iterator> live_its(requests.size());
+    for (auto& e : events) {
+        auto index = e.second.second;
+        if (!e.second.first) {
+            live.erase(live_its[index]);
+            continue;
+        }
+        auto start = entries[index]->offset;
+        auto end = start + entries[index]->size;
+        auto next = live.lower_bound(start);
+        bool overlap = (next != live.end() && next->first < end);
+        if (next != live.begin() && std::prev(next)->second > start) {
+            overlap = true;
+        }
+        if (overlap) {
+            result.num_overlaps++;
+        }
+        live_its[index] = live.emplace(start, end);
+    }
+
+    return result;
+}
+
+void allocatorPlanner::dump_plan(const std::string& filename) const {
+    std::ofstream out(filename);
+    out << "# allocatorSim static memory plan: <callpath> <occurrence> <offset> <size>" << std::endl;
+    out << "arena_size " << arena_size << std::endl;
+    for (auto& p : plan) {
+        out << p.first.first << " " << p.first.second << " "
+            << p.second.offset << " " << p.second.size << std::endl;
+    }
+    out.close();
+}
+
+bool allocatorPlanner::load_plan(const std::string& filename) {
+    std::ifstream in(filename);
+    if (!in.good()) {
+        return false;
+    }
+    plan.clear();
+    arena_size = 0;
+
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream ss(line);
+        std::string callpath;
+        ss >> callpath;
+        if (callpath == "arena_size") {
+            ss >> arena_size;
+            continue;
+        }
+        size_t occurrence = 0;
+        PlanEntry entry;
+        ss >> occurrence >> entry.offset >> entry.size;
+        plan.emplace(std::make_pair(callpath, occurrence), entry);
+    }
+    in.close();
+    return true;
+}
+
+size_t allocatorPlanner::get_arena_size() const {
+    return arena_size;
+}
+
+size_t allocatorPlanner::get_num_entries() const {
+    return plan.size();
+}
+
+void allocatorPlanner::report_validation(size_t iteration, const PlanValidation& result) {
+    std::cout << "[allocatorPlanner] iteration " << iteration
+              << ": allocations: " << result.num_allocations
+              << ", unplanned: " << result.num_unplanned
+              << ", oversized: " << result.num_oversized
+              << ", overlaps: " << result.num_overlaps
+              << (result.is_valid() ? " (valid)" : " (invalid)") << std::endl;
+}
+
+}  // namespace AllocatorSim
+}  // namespace cuda
+}  // namespace c10
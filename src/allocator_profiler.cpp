@@ -26,6 +26,9 @@ allocatorProf::~allocatorProf() {
     dump_allocator_snapshot_history(path + "snapshot_history.txt");
 
     dump_op_type_list(path + "op_type_list.log");
+
+    // about 1000 windows over the whole run
+    time_series.dump(path + "time_series.txt", std::max<size_t>(1, time_series.get_num_samples() / 1000));
 }
 
 void allocatorProf::update_segment_create(Block* block, size_t size) {
@@ -35,24 +38,46 @@ void allocatorProf::update_segment_create(Block* block, size_t size) {
     update_status(allocator_info.reserved_bytes, size);
 
     auto segment = SegmentInfo(op_id, block->ptr, size, block);
+    segment.num_blocks = 1;
+    segment.free_sizes.insert(size);
+    update_segment_metrics(segment);
     memory_segments.emplace(MemoryRange(block->ptr, block->ptr + size), segment);
     allocator_snapshot.emplace(segment, std::vector<BlockInfo>());
+
+    op_segment_alloc = true;
 }
 
 void allocatorProf::update_segment_release(Block* block) {
     ALLOCATOR_PROF_ENABLE();
 
     update_status(allocator_info.segments, -1);
-    update_status(allocator_info.reserved_bytes, block->size);
+    update_status(allocator_info.reserved_bytes, -static_cast<int64_t>(block->size));
 
     auto range = locate_segment(block);
-    auto segment = memory_segments.at(range);
+    auto& segment = memory_segments.at(range);
+    total_largest_freed_size -= segment.largest_freed_size;
 
     allocator_snapshot.erase(segment);
     memory_segments.erase(range);
 
-    allocator_snapshot_history.emplace(op_id, SnapShot(allocator_snapshot));
+    if (sim_control::SimulatorModeController::is_debug_poolinfo_dumpping()) {
+        allocator_snapshot_history.emplace(op_id, SnapShot(allocator_snapshot));
+    }
 
+    op_segment_release = true;
+}
+
+void allocatorProf::update_segment_metrics(SegmentInfo& segment) {
+    total_largest_freed_size -= segment.largest_freed_size;
+    segment.largest_freed_size = segment.free_sizes.empty() ? 0 : *segment.free_sizes.rbegin();
+    total_largest_freed_size += segment.largest_freed_size;
+
+    if (segment.total_size - segment.allocated_size != 0) {
+        segment.fragmentation = 1 - ((float)segment.largest_freed_size) 
+                            / (segment.total_size - segment.allocated_size);
+    } else {
+        segment.fragmentation = 0;
+    }
 }
 
 void allocatorProf::update_block_change(Block* block, 
@@ -60,16 +85,18 @@ void allocatorProf::update_block_change(Block* block,
                                         SegmentInfo& segment) {
     ALLOCATOR_PROF_ENABLE();
 
-    auto& blocks = allocator_snapshot.at(segment);
-
     if (block->ptr == segment.address) {
         segment.first_block = block;
     }
 
-    segment.num_blocks = 0;
-    segment.num_allocated_blocks = 0;
-    segment.allocated_size = 0;
-    segment.largest_freed_size = 0;
+    update_segment_metrics(segment);
+
+    // walking the blocks is only needed for the snapshot dump
+    if (!sim_control::SimulatorModeController::is_debug_poolinfo_dumpping()) {
+        return;
+    }
+
+    auto& blocks = allocator_snapshot.at(segment);
     blocks.clear();
 
     Block* fblock = segment.first_block;
@@ -77,33 +104,39 @@ void allocatorProf::update_block_change(Block* block,
         blocks.push_back(
             BlockInfo(fblock->size, fblock->ptr, fblock->allocated)
         );
-
-        if (fblock->allocated) {
-            segment.allocated_size += fblock->size;
-            segment.num_allocated_blocks++;
-        } else {
-            segment.largest_freed_size = 
-                std::max(segment.largest_freed_size, fblock->size);
-        }
-        segment.num_blocks++;
-
         fblock = fblock->next;
     }
-    if (segment.total_size - segment.allocated_size != 0) {
-        segment.fragmentation = 1 - ((float)segment.largest_freed_size) 
-                            / (segment.total_size - segment.allocated_size);
-    } else {
-        segment.fragmentation = 0;
-    }
 
     allocator_snapshot_history.emplace(op_id, SnapShot(allocator_snapshot));
 
 }
 
-void allocatorProf::update_block_allocate(Block* block) {
+void allocatorProf::update_block_split(Block* block, Block* remaining) {
     ALLOCATOR_PROF_ENABLE();
 
-    op_type_list.emplace(op_id, true);
+    auto range = locate_segment(block);
+    auto& segment = memory_segments.at(range);
+
+    segment.free_sizes.erase(segment.free_sizes.find(block->size + remaining->size));
+    segment.free_sizes.insert(block->size);
+    segment.free_sizes.insert(remaining->size);
+    segment.num_blocks++;
+
+    op_split = true;
+}
+
+void allocatorProf::update_block_merge(Block* block, size_t subsumed_size) {
+    ALLOCATOR_PROF_ENABLE();
+
+    auto range = locate_segment(block);
+    auto& segment = memory_segments.at(range);
+
+    segment.free_sizes.erase(segment.free_sizes.find(subsumed_size));
+    segment.num_blocks--;
+}
+
+void allocatorProf::update_block_allocate(Block* block) {
+    ALLOCATOR_PROF_ENABLE();
 
     update_status(allocator_info.blocks, 1);
     update_status(allocator_info.allocated_bytes, block->size);
@@ -115,20 +148,20 @@ void allocatorProf::update_block_allocate(Block* block) {
         segment.empty_range.push_back(op_id);
     }
 
-    update_block_change(block, range, segment);
+    segment.free_sizes.erase(segment.free_sizes.find(block->size));
+    segment.allocated_size += block->size;
+    segment.num_allocated_blocks++;
 
-    allocator_info_history.push_back(AllocatorInfo(allocator_info));
+    update_block_change(block, range, segment);
 
-    op_id++;
+    record_op(false);
 }
 
 void allocatorProf::update_block_free(Block* block, size_t size) {
     ALLOCATOR_PROF_ENABLE();
 
-    op_type_list.emplace(op_id, false);
-
     update_status(allocator_info.blocks, -1);
-    update_status(allocator_info.allocated_bytes, size);
+    update_status(allocator_info.allocated_bytes, -static_cast<int64_t>(size));
     auto range = locate_segment(block);
     auto& segment = memory_segments.at(range);
 
@@ -136,13 +169,58 @@ void allocatorProf::update_block_free(Block* block, size_t size) {
         segment.empty_range.push_back(op_id);
     }
 
+    // block has been merged with its free neighbors
+    segment.free_sizes.insert(block->size);
+    segment.allocated_size -= size;
+    segment.num_allocated_blocks--;
+
     update_block_change(block, range, segment);
 
-    allocator_info_history.push_back(AllocatorInfo(allocator_info));
+    record_op(true);
+}
+
+void allocatorProf::record_op(bool is_free) {
+    auto op = OpInfo(
+        op_id,
+        op_segment_alloc,
+        is_free,
+        op_segment_release,
+        op_split,
+        allocator_info.allocated_bytes.current,
+        allocator_info.allocated_bytes.peak,
+        allocator_info.reserved_bytes.current,
+        allocator_info.reserved_bytes.peak);
+    op.fragmentation = get_fragmentation();
+    op_list.push(op);
+
+    time_series.record(SeriesSample(
+        op_id,
+        allocator_info.reserved_bytes.current,
+        allocator_info.allocated_bytes.current,
+        allocator_info.segments.current,
+        op.fragmentation));
+
+    op_segment_alloc = false;
+    op_segment_release = false;
+    op_split = false;
 
     op_id++;
 }
 
+float allocatorProf::get_fragmentation() {
+    size_t freed_size = allocator_info.reserved_bytes.current - allocator_info.allocated_bytes.current;
+    if (freed_size == 0) {
+        return 0;
+    }
+    return 1 - ((float)total_largest_freed_size) / freed_size;
+}
+
+std::vector<SeriesWindow> allocatorProf::query_time_series(size_t resolution,
+                                                          op_id_t begin,
+                                                          op_id_t end) const {
+    return time_series.query(resolution, begin, end);
+}
+
 void allocatorProf::update_status(Status& stat, int64_t amount) {
     stat.current += amount;
 
@@ -156,28 +234,10 @@ void allocatorProf::update_status(Status& stat, int64_t amount) {
 }
 
 MemoryRange allocatorProf::locate_segment(Block* block) {
-    size_t len = memory_segments.size();
-    MemoryRange address_map[len];
-    // @todo(Lin-Mao): change to sorted set
-
-    size_t count = 0;
-    for (auto i : memory_segments) {
-    address_map[count++] = i.first;
-    }
-
-    // binary search
-    size_t low = 0, mid = 0, high = len - 1;
-    while (low < high) {
-        mid = (low + high + 1) >> 1; // Round up, otherwise infinite loop
-        if (address_map[mid].start > (size_t) block->ptr) {
-            high = (mid > 0) ? (mid - 1) : 0; // otherwise overflow
-        } else {
-            low = mid;
-        }
-    }
-
-    if (address_map[low].start <= (size_t) block->ptr) {
-        return address_map[low];
+    // segments are sorted by the start address
+    auto it = memory_segments.upper_bound(MemoryRange(block->ptr, block->ptr));
+    if (it != memory_segments.begin()) {
+        return std::prev(it)->first;
     } else {
     printf("It shouldn't take this branch. Please check!!!\n");
     return MemoryRange();
@@ -217,9 +277,11 @@ void allocatorProf::dump_allocator_snapshot_history(std::string filename) {
 }
 
 void allocatorProf::dump_op_type_list(std::string filename) {
+    // only the ops still held in op_list, true for a block allocate
     std::ofstream out(filename);
-    for (auto op : op_type_list) {
-        out << op.first << ": " << std::boolalpha << op.second << std::endl;
+    for (size_t i = 0; i < op_list.size(); i++) {
+        auto& op = op_list.at(i);
+        out << op.op_id << ": " << std::boolalpha << !op.is_free << std::endl;
     }
     out.close();
 }
@@ -0,0 +1,137 @@
+#include "allocator_search.h"
+
+#include <algorithm>
+
+namespace c10 {
+namespace cuda {
+namespace AllocatorSim {
+
+namespace {
+    // threads of a search started with num_threads = 0
+    const size_t DEFAULT_SEARCH_THREADS = 2;
+}   // anonymous namespace for variables
+
+allocatorSearch::allocatorSearch(int device, int stream,
+                                 std::vector<ReplayEvent> events,
+                                 std::vector<ReplaySlot> slots,
+                                 steadyState steady,
+                                 std::vector<size_t> groups,
+                                 const std::vector<SizingParams>& params)
+    : device(device), stream(stream), events(std::move(events)), slots(std::move(slots)),
+      steady(std::move(steady)), groups(std::move(groups)) {
+    candidates.resize(params.size());
+    for (size_t i = 0; i < params.size(); i++) {
+        candidates[i].params = params[i];
+    }
+}
+
+allocatorSearch::~allocatorSearch() {
+    cancel();
+    wait();
+}
+
+void allocatorSearch::start(size_t num_threads) {
+    if (num_threads == 0) {
+        num_threads = std::min<size_t>(DEFAULT_SEARCH_THREADS,
+                                       std::max<size_t>(std::thread::hardware_concurrency(), 1));
+    }
+    num_threads = std::min(num_threads, std::max<size_t>(candidates.size(), 1));
+    for (size_t i = 0; i < num_threads; i++) {
+        workers.emplace_back(&allocatorSearch::run, this);
+    }
+}
+
+void allocatorSearch::run() {
+    while (!cancelled.load(std::memory_order_relaxed)) {
+        auto i = next_candidate.fetch_add(1, std::memory_order_relaxed);
+        if (i >= candidates.size()) {
+            return;
+        }
+        evaluate(candidates[i]);
+        // publish the result to is_done()
+        num_evaluated.fetch_add(1, std::memory_order_release);
+    }
+}
+
+void allocatorSearch::evaluate(SearchResult& candidate) {
+    allocatorSim sim;
+    sim.pin_configs(candidate.params);
+    sim.pin_groups(groups);
+    std::vector<Block*> blocks(slots.size(), nullptr);
+    std::unique_ptr<steadyStateReplay> replay;
+    if (steady.is_periodic()) {
+        replay.reset(new steadyStateReplay(steady, events, slots));
+    }
+    auto block_of = [&blocks](uint32_t slot) -> Block*& { return blocks[slot]; };
+    for (size_t i = 0; i < events.size(); i++) {
+        if (replay && steady.is_boundary(i)) {
+            i = replay->on_boundary(i, sim, block_of);
+        }
+        auto& e = events[i];
+        sim.set_op_id(e.op_id);
+        if (e.type == ALLOCATOR_MALLOC_BLOCK) {
+            blocks[e.slot] = sim.malloc(device, slots[e.slot].size, stream);
+            if (replay) {
+                replay->on_malloc(e.slot);
+            }
+        } else if (e.type == ALLOCATOR_FREE_BLOCK) {
+            sim.free(blocks[e.slot]);
+            blocks[e.slot] = nullptr;
+            if (replay) {
+                replay->on_free(e.slot);
+            }
+        } else if (e.type == ALLOCATOR_EMPYT_CACHE) {
+            sim.empty_cache();
+        }
+    }
+    candidate.reserved_size = sim.get_max_reserved_bytes();
+    candidate.allocated_size = sim.get_max_allocated_bytes();
+    candidate.max_num_segments = sim.get_max_num_segments();
+    candidate.fragmentation = sim.get_peak_fragmentation_bytes();
+    candidate.op_counts = sim.get_op_counts();
+    if (replay) {
+        candidate.op_counts += replay->get_skipped_op_counts();
+    }
+}
+
+bool allocatorSearch::is_done() const {
+    return num_evaluated.load(std::memory_order_acquire) == candidates.size();
+}
+
+void allocatorSearch::wait() {
+    for (auto& worker : workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+void allocatorSearch::cancel() {
+    cancelled.store(true, std::memory_order_relaxed);
+}
+
+std::pair<size_t, size_t> allocatorSearch::get_progress() const {
+    return std::make_pair(num_evaluated.load(std::memory_order_relaxed), candidates.size());
+}
+
+const std::vector<size_t>& allocatorSearch::get_groups() const {
+    return groups;
+}
+
+const SearchResult& allocatorSearch::get_candidate(size_t i) const {
+    return candidates[i];
+}
+
+const SearchResult& allocatorSearch::get_best(const SearchTradeoff& tradeoff) const {
+    size_t best = 0;
+    for (size_t i = 1; i < candidates.size(); i++) {
+        if (tradeoff.cost(candidates[i].get_cost()) < tradeoff.cost(candidates[best].get_cost())) {
+            best = i;
+        }
+    }
+    return candidates[best];
+}
+
+}  // namespace AllocatorSim
+}  // namespace cuda
+}  // namespace c10
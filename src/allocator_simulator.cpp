@@ -33,6 +33,8 @@ allocatorSim::allocatorSim()
     large_blocks = BlockPool(BlockComparator, false);
 
     allocator_prof = new allocatorProf();
+
+    load_configs();
 }
 
 allocatorSim::~allocatorSim() {
@@ -48,26 +50,29 @@ void allocatorSim::test_allocator() {
     std::cout << "Hello allocator!" << std::endl;
 }
 
+void allocatorSim::load_configs() {
+    sizing_params.kMinBlockSize = allocatorConf::get_kMinBlockSize();
+    sizing_params.kSmallSize = allocatorConf::get_kSmallSize();
+    sizing_params.kSmallBuffer = allocatorConf::get_kSmallBuffer();
+    sizing_params.kLargeBuffer = allocatorConf::get_kLargeBuffer();
+    sizing_params.kMinLargeAlloc = allocatorConf::get_kMinLargeAlloc();
+    sizing_params.kRoundLarge = allocatorConf::get_kRoundLarge();
+    sizing_params.max_split_size = allocatorConf::get_max_split_size();
+    sizing_params.roundup_power2_divisions = allocatorConf::get_roundup_power2_divisions();
+    sizing_params.roundup_bypass_threshold = allocatorConf::get_roundup_bypass_threshold();
+    sizing_params.garbage_collection_threshold = allocatorConf::get_garbage_collection_threshold();
+
+    sizing_funcs = get_sizing_funcs(sizing_params.kMinBlockSize, sizing_params.kRoundLarge);
+    loaded_config_version = allocatorConf::get_config_version();
+}
+
 size_t allocatorSim::round_size(size_t size) {
-    auto min_block_size = allocatorConf::get_kMinBlockSize();
-    if (size < min_block_size) {
-        return min_block_size;
-    } else if (size > allocatorConf::get_roundup_bypass_threshold()) {
-        return min_block_size * ((size + min_block_size - 1) / min_block_size);
-    } else {
-        auto divisions = allocatorConf::get_roundup_power2_divisions();
-        if (divisions > 0 && size > (min_block_size * divisions)) {
-        // return roundup_power2_next_division(size, divisions);
-        // not taken
-        return size;
-        } else {
-        return min_block_size * ((size + min_block_size - 1) / min_block_size);
-        }
-    }
+    // roundup_power2_next_division is not taken, see SizingPolicy::round_size
+    return sizing_funcs->round_size(sizing_params, size);
 }
 
 BlockPool& allocatorSim::get_pool(size_t size, int stream) {
-    if (size <= allocatorConf::get_kSmallSize()) {
+    if (size <= sizing_params.kSmallSize) {
         return small_blocks;
     } else {
         return large_blocks;
@@ -75,62 +80,29 @@ BlockPool& allocatorSim::get_pool(size_t size, int stream) {
 }
 
 size_t allocatorSim::get_grouped_allocation_size_sim(size_t size) {
-    if (size < allocatorConf::_GROUPS[0]) {
-        if (allocatorConf::_GROUPS[0] != std::numeric_limits<size_t>::max()) {
-            return allocatorConf::_GROUPS[0];
-        } else {
-            auto tunablekRoundLarge = AllocatorSim::allocatorConf::get_kRoundLarge();
-            return tunablekRoundLarge * ((size + tunablekRoundLarge - 1) / tunablekRoundLarge);
-        }
-    } else if (size < allocatorConf::_GROUPS[1]) {
-        if (allocatorConf::_GROUPS[1] != std::numeric_limits<size_t>::max()) {
-            return allocatorConf::_GROUPS[1];
-        } else {
-            auto tunablekRoundLarge = AllocatorSim::allocatorConf::get_kRoundLarge();
-            return tunablekRoundLarge * ((size + tunablekRoundLarge - 1) / tunablekRoundLarge);
-        }
-    } else if (size < allocatorConf::_GROUPS[2]) {
-        if (allocatorConf::_GROUPS[2] != std::numeric_limits<size_t>::max()) {
-            return allocatorConf::_GROUPS[2];
-        } else {
-            auto tunablekRoundLarge = AllocatorSim::allocatorConf::get_kRoundLarge();
-            return tunablekRoundLarge * ((size + tunablekRoundLarge - 1) / tunablekRoundLarge);
-        }
-    } else if (size < allocatorConf::_GROUPS[3]) {
-        if (allocatorConf::_GROUPS[3] != std::numeric_limits<size_t>::max()) {
-            return allocatorConf::_GROUPS[3];
-        } else {
-            auto tunablekRoundLarge = AllocatorSim::allocatorConf::get_kRoundLarge();
-            return tunablekRoundLarge * ((size + tunablekRoundLarge - 1) / tunablekRoundLarge);
-        }
-    } else if (size < allocatorConf::_GROUPS[4]) {
-        if (allocatorConf::_GROUPS[4] != std::numeric_limits<size_t>::max()) {
-            return allocatorConf::_GROUPS[4];
-        } else {
-            auto tunablekRoundLarge = AllocatorSim::allocatorConf::get_kRoundLarge();
-            return tunablekRoundLarge * ((size + tunablekRoundLarge - 1) / tunablekRoundLarge);
-        }
-    } else {
-        auto tunablekRoundLarge = AllocatorSim::allocatorConf::get_kRoundLarge();
-        return tunablekRoundLarge * ((size + tunablekRoundLarge - 1) / tunablekRoundLarge);
-    }
+    auto group_size = groups_pinned ? allocatorConf::get_group_size(pinned_groups, size)
+                                    : allocatorConf::get_group_size(size);
+    return group_size ? group_size : sizing_funcs->round_large(sizing_params, size);
 }
 
 void allocatorSim::set_group_enable_flag_sim(bool flag) {
     group_enable_flag_sim = flag;
 }
 
+bool allocatorSim::get_group_enable_flag_sim() const {
+    return group_enable_flag_sim;
+}
+
 size_t allocatorSim::get_allocation_size(size_t size) {
-    if (group_enable_flag_sim && size > allocatorConf::get_kLargeBuffer()) {
+    if (group_enable_flag_sim && size > sizing_params.kLargeBuffer) {
         return get_grouped_allocation_size_sim(size);
     }
-    if (size <= allocatorConf::get_kSmallSize()) {
-        return allocatorConf::get_kSmallBuffer();
-    } else if (size < allocatorConf::get_kMinLargeAlloc()) {
-        return allocatorConf::get_kLargeBuffer();
+    if (size <= sizing_params.kSmallSize) {
+        return sizing_params.kSmallBuffer;
+    } else if (size < sizing_params.kMinLargeAlloc) {
+        return sizing_params.kLargeBuffer;
     } else {
-        auto round_large = allocatorConf::get_kRoundLarge();
-        return round_large * ((size + round_large - 1) / round_large);
+        return sizing_funcs->round_large(sizing_params, size);
     }
 }
 
@@ -148,12 +120,13 @@ Block* allocatorSim::retrieve_released_block(uint64_t ptr) {
 }
 
 bool allocatorSim::get_free_block(AllocParams& p) {
+    op_counts.pool_lookups++;
     BlockPool& pool = *p.pool;
     auto it = pool.blocks.lower_bound(&p.search_key);
     if (it == pool.blocks.end() || (*it)->stream != p.stream())
         return false;
-    if ((p.size() >= allocatorConf::get_max_split_size()) &&
-        ((*it)->size >= p.size() + allocatorConf::get_kLargeBuffer()))
+    if ((p.size() >= sizing_params.max_split_size) &&
+        ((*it)->size >= p.size() + sizing_params.kLargeBuffer))
         return false;
     p.block = *it;
     (*it)->gc_count = 0; // Denote this block has been used
@@ -182,7 +155,14 @@ bool allocatorSim::alloc_block(AllocParams& p, bool isRetry, void* o_ptr) {
     p.block = new Block(p.device(), p.stream(), size, p.pool, ptr);
 
     current_reserved_bytes += size;
-    max_reserved_bytes = std::max(current_reserved_bytes, max_reserved_bytes);
+    if (current_reserved_bytes > max_reserved_bytes) {
+        max_reserved_bytes = current_reserved_bytes;
+        max_reserved_op_id = current_op_id;
+    }
+
+    if (timeline) {
+        timeline->segment_create(current_op_id, ptr, size, p.pool->is_small);
+    }
 
     return true;
 }
@@ -190,23 +170,32 @@ bool allocatorSim::alloc_block(AllocParams& p, bool isRetry, void* o_ptr) {
 void allocatorSim::release_block(Block* block) {
     allocator_prof->update_segment_release(block);
     current_reserved_bytes -= block->size;
+    op_counts.segment_releases++;
+    op_counts.segment_release_bytes += block->size;
     auto* pool = block->pool;
     pool->blocks.erase(block);
     device_allocator.free(block->ptr, block->size);
 
     _active_segments.erase(block->ptr);
 
+    if (timeline) {
+        timeline->segment_release(current_op_id, block->ptr, block->size);
+        timeline->memory_counters(current_op_id, current_allocated_bytes, current_reserved_bytes);
+    }
+
     auto free_op_info = std::make_tuple(true, block->size, current_allocated_bytes, current_reserved_bytes);
     DumpDebugging::dumpDebuggingInfo(
         DumpDebugging::BLOCK_FREE_OP_HISTORY,
         std::bind(&DumpDebugging::dump_block_free_op, true, free_op_info)
     );
 
-    auto layout_info = std::make_tuple(block->ptr, block->size, _active_segments);
-    DumpDebugging::dumpDebuggingInfo(
-        DumpDebugging::ACTIVE_SEGMENT_LAYOUT,
-        std::bind(&DumpDebugging::dump_segment_layout, true, layout_info)
-    );
+    if (sim_control::SimulatorModeController::is_debug_dumpping()) {
+        auto layout_info = std::make_tuple(block->ptr, block->size, _active_segments);
+        DumpDebugging::dumpDebuggingInfo(
+            DumpDebugging::ACTIVE_SEGMENT_LAYOUT,
+            std::bind(&DumpDebugging::dump_segment_layout, true, layout_info)
+        );
+    }
 
     auto segment_op_info = std::make_tuple(true, block->size);
     DumpDebugging::dumpDebuggingInfo(
@@ -223,6 +212,8 @@ bool allocatorSim::release_available_cached_blocks(AllocParams& p) {
 }
 
 bool allocatorSim::release_cached_blocks() {
+    // synchronizes the device before the cudaFree calls
+    op_counts.cache_flushes++;
     release_blocks(large_blocks);
     release_blocks(small_blocks);
 
@@ -236,24 +227,30 @@ void allocatorSim::empty_cache() {
 bool allocatorSim::should_split(const Block* block, size_t size) {
     size_t remaining = block->size - size;
     if (block->pool->is_small) {
-        return remaining >= allocatorConf::get_kMinBlockSize();
+        return remaining >= sizing_params.kMinBlockSize;
     } else {
-        return (size < allocatorConf::get_max_split_size()) &&
-            (remaining > allocatorConf::get_kSmallSize());
+        return (size < sizing_params.max_split_size) &&
+            (remaining > sizing_params.kSmallSize);
     }
 }
 
 Block* allocatorSim::malloc(int device, size_t orig_size, int stream, void* o_ptr) {
+    if (UNLIKELY(!configs_pinned && loaded_config_version != allocatorConf::get_config_version())) {
+        load_configs();
+    }
     size_t size = round_size(orig_size);
     auto& pool = get_pool(size, stream);
     const size_t alloc_size = get_allocation_size(size);
     AllocParams params(device, size, stream, &pool, alloc_size);
 
-    auto pools_info = std::make_tuple(small_blocks.blocks, large_blocks.blocks);
-    DumpDebugging::dumpDebuggingInfo(
-        DumpDebugging::BLOCK_POOLS_SNAPSHOT,
-        std::bind(&DumpDebugging::dump_block_pools_snapshot, true, pools_info)
-    );
+    // the snapshot copies both pools, only build it when dumping
+    if (sim_control::SimulatorModeController::is_debug_dumpping()) {
+        auto pools_info = std::make_tuple(small_blocks.blocks, large_blocks.blocks);
+        DumpDebugging::dumpDebuggingInfo(
+            DumpDebugging::BLOCK_POOLS_SNAPSHOT,
+            std::bind(&DumpDebugging::dump_block_pools_snapshot, true, pools_info)
+        );
+    }
 
     bool block_found = get_free_block(params)
         // Trigger callbacks and retry search
@@ -262,7 +259,7 @@ Block* allocatorSim::malloc(int device, size_t orig_size, int stream, void* o_pt
     bool real_alloc = false;
     if (!block_found) {
         // Do garbage collection if the flag is set.
-        if (UNLIKELY(allocatorConf::get_garbage_collection_threshold() > 0.0)) {
+        if (UNLIKELY(sizing_params.garbage_collection_threshold > 0.0)) {
             garbage_collect_cached_blocks();
         }
         // Attempt allocate
@@ -318,15 +315,32 @@ Block* allocatorSim::malloc(int device, size_t orig_size, int stream, void* o_pt
         bool inserted = pool.blocks.insert(remaining).second;
 
         assert(inserted);
+
+        allocator_prof->update_block_split(block, remaining);
+
+        if (timeline) {
+            timeline->block_split(current_op_id, block->ptr, block->size, remaining->size);
+        }
     }
 
     block->allocated = true;
+    block->requested_size = orig_size;
 
     current_allocated_bytes += block->size;
-    max_allocated_bytes = std::max(current_allocated_bytes, max_allocated_bytes);
+    current_requested_bytes += orig_size;
+    if (current_allocated_bytes > max_allocated_bytes) {
+        max_allocated_bytes = current_allocated_bytes;
+        max_allocated_op_id = current_op_id;
+        peak_fragmentation_bytes = current_allocated_bytes - current_requested_bytes;
+    }
 
     allocator_prof->update_block_allocate(block);
 
+    if (timeline) {
+        timeline->block_allocate(current_op_id, block->ptr, block->size, orig_size);
+        timeline->memory_counters(current_op_id, current_allocated_bytes, current_reserved_bytes);
+    }
+
     auto malloc_op_info = std::make_tuple(real_alloc, split_flag, orig_size, size, alloc_size, before_split_size, current_allocated_bytes, current_reserved_bytes);
     DumpDebugging::dumpDebuggingInfo(
         DumpDebugging::BLOCK_MALLOC_OP_HISTORY,
@@ -335,6 +349,9 @@ Block* allocatorSim::malloc(int device, size_t orig_size, int stream, void* o_pt
 
     if (real_alloc) {
         _active_segments.emplace(block->ptr, std::make_pair(get_global_op_id(), alloc_size));
+        max_num_segments = std::max(max_num_segments, _active_segments.size());
+        op_counts.segment_allocs++;
+        op_counts.segment_alloc_bytes += alloc_size;
 
         auto segment_op_info = std::make_tuple(false, alloc_size);
         DumpDebugging::dumpDebuggingInfo(
@@ -342,11 +359,13 @@ Block* allocatorSim::malloc(int device, size_t orig_size, int stream, void* o_pt
             std::bind(&DumpDebugging::dump_segment_op, true, segment_op_info)
         );
 
-        auto layout_info = std::make_tuple(block->ptr, alloc_size, _active_segments);
-        DumpDebugging::dumpDebuggingInfo(
-            DumpDebugging::ACTIVE_SEGMENT_LAYOUT, 
-            std::bind(&DumpDebugging::dump_segment_layout, true, layout_info)    
-        );
+        if (sim_control::SimulatorModeController::is_debug_dumpping()) {
+            auto layout_info = std::make_tuple(block->ptr, alloc_size, _active_segments);
+            DumpDebugging::dumpDebuggingInfo(
+                DumpDebugging::ACTIVE_SEGMENT_LAYOUT,
+                std::bind(&DumpDebugging::dump_segment_layout, true, layout_info)
+            );
+        }
     }
     return block;
 }
@@ -372,6 +391,10 @@ size_t allocatorSim::try_merge_blocks(Block* dst, Block* src, BlockPool& pool) {
     dst->size += subsumed_size;
     auto erased = pool.blocks.erase(src);
     assert(erased);
+    allocator_prof->update_block_merge(dst, subsumed_size);
+    if (timeline) {
+        timeline->block_merge(current_op_id, dst->ptr, dst->size, subsumed_size);
+    }
     delete src;
 
     return subsumed_size;
@@ -414,21 +437,33 @@ void allocatorSim::free_block(Block* block) {
 }
 
 void allocatorSim::free(Block* block) {
-    auto pool_info = std::make_tuple(small_blocks.blocks, large_blocks.blocks);
-    DumpDebugging::dumpDebuggingInfo(
-        DumpDebugging::BLOCK_POOLS_SNAPSHOT,
-        std::bind(&DumpDebugging::dump_block_pools_snapshot, true, pool_info)
-    );
+    if (sim_control::SimulatorModeController::is_debug_dumpping()) {
+        auto pool_info = std::make_tuple(small_blocks.blocks, large_blocks.blocks);
+        DumpDebugging::dumpDebuggingInfo(
+            DumpDebugging::BLOCK_POOLS_SNAPSHOT,
+            std::bind(&DumpDebugging::dump_block_pools_snapshot, true, pool_info)
+        );
+    }
 
     block->allocated = false;
 
     // auto orig_block_ptr = block->ptr;
     auto orig_block_size = block->size;
+    current_requested_bytes -= block->requested_size;
+
+    // before merging, the block may take the address of its prev block
+    if (timeline) {
+        timeline->block_free(current_op_id, block->ptr, orig_block_size);
+    }
 
     free_block(block);
 
     current_allocated_bytes -= orig_block_size;
 
+    if (timeline) {
+        timeline->memory_counters(current_op_id, current_allocated_bytes, current_reserved_bytes);
+    }
+
     auto free_op_info = std::make_tuple(false, orig_block_size, current_allocated_bytes, current_reserved_bytes);
     DumpDebugging::dumpDebuggingInfo(
         DumpDebugging::BLOCK_FREE_OP_HISTORY, 
@@ -443,6 +478,10 @@ std::pair<size_t, size_t> allocatorSim::get_max_memory_usage() {
     return std::make_pair(max_allocated_bytes, max_reserved_bytes);
 }
 
+std::pair<size_t, size_t> allocatorSim::get_current_memory_usage() {
+    return std::make_pair(current_allocated_bytes, current_reserved_bytes);
+}
+
 size_t allocatorSim::get_max_reserved_bytes() {
     return max_reserved_bytes;
 }
@@ -451,11 +490,92 @@ size_t allocatorSim::get_max_allocated_bytes() {
     return max_allocated_bytes;
 }
 
+std::pair<op_id_t, op_id_t> allocatorSim::get_peak_op_ids() {
+    return std::make_pair(max_allocated_op_id, max_reserved_op_id);
+}
+
+std::pair<size_t, size_t> allocatorSim::get_cached_bytes() {
+    size_t small_bytes = 0;
+    size_t large_bytes = 0;
+    for (auto b : small_blocks.blocks) {
+        small_bytes += b->size;
+    }
+    for (auto b : large_blocks.blocks) {
+        large_bytes += b->size;
+    }
+    return std::make_pair(small_bytes, large_bytes);
+}
+
+size_t allocatorSim::get_max_num_segments() {
+    return max_num_segments;
+}
+
+size_t allocatorSim::get_num_segment_ops() {
+    return op_counts.get_segment_ops();
+}
+
+const AllocatorOpCounts& allocatorSim::get_op_counts() const {
+    return op_counts;
+}
+
+size_t allocatorSim::get_peak_fragmentation_bytes() {
+    return peak_fragmentation_bytes;
+}
+
+void allocatorSim::set_op_id(op_id_t op_id) {
+    current_op_id = op_id;
+}
+
+void allocatorSim::set_timeline(allocatorTimeline* timeline) {
+    this->timeline = timeline;
+}
+
+void allocatorSim::pin_configs(const SizingParams& params) {
+    sizing_params = params;
+    sizing_funcs = get_sizing_funcs(sizing_params.kMinBlockSize, sizing_params.kRoundLarge);
+    configs_pinned = true;
+}
+
+void allocatorSim::pin_groups(const std::vector<size_t>& groups) {
+    pinned_groups = groups;
+    groups_pinned = true;
+    group_enable_flag_sim = !groups.empty();
+}
+
+const SizingParams& allocatorSim::get_sizing_params() const {
+    return sizing_params;
+}
+
+void allocatorSim::get_state(std::vector<uint64_t>& state) const {
+    state.push_back(current_reserved_bytes);
+    state.push_back(current_allocated_bytes);
+    // device_allocator is the complement of the segments
+    state.push_back(_active_segments.size());
+    for (auto& segment : _active_segments) {
+        state.push_back(segment.first);
+        state.push_back(segment.second.second);
+    }
+    for (auto* pool : {&small_blocks, &large_blocks}) {
+        state.push_back(pool->blocks.size());
+        for (auto b : pool->blocks) {
+            state.push_back(b->ptr);
+            state.push_back(b->size);
+            state.push_back((b->prev ? 1 : 0) | (b->next ? 2 : 0));
+        }
+    }
+}
+
 void allocatorSim::reset_memory_usage() {
     max_allocated_bytes = 0;
     current_allocated_bytes = 0;
     max_reserved_bytes = 0;
     current_reserved_bytes = 0;
+    max_allocated_op_id = 0;
+    max_reserved_op_id = 0;
+    max_num_segments = _active_segments.size();
+    op_counts = AllocatorOpCounts();
+    current_requested_bytes = 0;
+    peak_fragmentation_bytes = 0;
 }
 
 }  // namespace AllocatorSim
@@ -0,0 +1,59 @@
+#include "allocator_sizing.h"
+
+#include <utility>
+
+namespace c10 {
+namespace cuda {
+namespace AllocatorSim {
+
+namespace {
+
+constexpr size_t NUM_ROUND_LARGE = kRoundLarge_grid.size();
+constexpr size_t NUM_SIZING_FUNCS = kMinBlockSize_grid.size() * NUM_ROUND_LARGE;
+
+template <size_t K>
+constexpr SizingFuncs make_sizing_funcs() {
+    using Policy = SizingPolicy<
+        ConstMinBlockSize<kMinBlockSize_grid[K / NUM_ROUND_LARGE]>,
+        ConstRoundLarge<kRoundLarge_grid[K % NUM_ROUND_LARGE]>>;
+    return SizingFuncs{&Policy::round_size, &Policy::round_large};
+}
+
+template <size_t... Ks>
+constexpr std::array<SizingFuncs, sizeof...(Ks)> make_sizing_table(std::index_sequence<Ks...>) {
+    return {{make_sizing_funcs<Ks>()...}};
+}
+
+// row-major over <kMinBlockSize_grid, kRoundLarge_grid>
+const std::array<SizingFuncs, NUM_SIZING_FUNCS> sizing_table =
+    make_sizing_table(std::make_index_sequence<NUM_SIZING_FUNCS>{});
+
+const SizingFuncs runtime_sizing_funcs {
+    &SizingPolicy<RuntimeMinBlockSize, RuntimeRoundLarge>::round_size,
+    &SizingPolicy<RuntimeMinBlockSize, RuntimeRoundLarge>::round_large
+};
+
+template <size_t N>
+size_t grid_index(const std::array<size_t, N>& grid, size_t value) {
+    for (size_t i = 0; i < N; i++) {
+        if (grid[i] == value) {
+            return i;
+        }
+    }
+    return N;
+}
+
+}  // anonymous namespace for dispatch table
+
+const SizingFuncs* get_sizing_funcs(size_t kMinBlockSize, size_t kRoundLarge) {
+    auto i = grid_index(kMinBlockSize_grid, kMinBlockSize);
+    auto j = grid_index(kRoundLarge_grid, kRoundLarge);
+    if (i == kMinBlockSize_grid.size() || j == kRoundLarge_grid.size()) {
+        return &runtime_sizing_funcs;
+    }
+    return &sizing_table[i * NUM_ROUND_LARGE + j];
+}
+
+}  // namespace AllocatorSim
+}  // namespace cuda
+}  // namespace c10
@@ -0,0 +1,118 @@
+#include "allocator_slice.h"
+#include "allocator_compress.h"
+
+#include <algorithm>
+
+namespace c10 {
+namespace cuda {
+namespace AllocatorSim {
+
+traceSlicer::traceSlicer(const trace_t& blocks) : blocks(blocks) {
+    std::vector<size_t> sizes;
+    sizes.reserve(blocks.size());
+    for (auto& t : blocks) {
+        sizes.push_back(t.second.second);
+    }
+    auto period = std::max<size_t>(compressedTrace::detect_period(sizes), 1);
+
+    size_t index = 0;
+    for (auto& t : blocks) {
+        if (index++ % period == 0) {
+            iteration_starts.push_back(t.first);
+        }
+    }
+}
+
+size_t traceSlicer::get_num_iterations() const {
+    return iteration_starts.size();
+}
+
+std::pair<op_id_t, op_id_t> traceSlicer::get_iteration_window(size_t first, size_t last) const {
+    auto n = iteration_starts.size();
+    op_id_t start = (first < n) ? iteration_starts[first] : std::numeric_limits<op_id_t>::max();
+    op_id_t end = (last < n) ? iteration_starts[last] : std::numeric_limits<op_id_t>::max();
+    // the first iteration also has the frees before its first malloc
+    if (first == 0) {
+        start = 0;
+    }
+    return std::make_pair(start, end);
+}
+
+SliceInfo traceSlicer::slice(op_id_t start, op_id_t end, trace_t& out) const {
+    SliceInfo info;
+    out.clear();
+    if (start >= end) {
+        return info;
+    }
+
+    // <malloc_op_id, free_op_id, size> of the kept blocks, original op_ids
+    std::vector<std::tuple<op_id_t, op_id_t, size_t>> prologue;
+    std::vector<std::tuple<op_id_t, op_id_t, size_t>> window;
+    for (auto& t : blocks) {
+        if (t.first >= end) {
+            break;
+        }
+        if (t.first < start) {
+            if (t.second.first >= start) {
+                prologue.emplace_back(t.first, t.second.first, t.second.second);
+            }
+        } else {
+            window.emplace_back(t.first, t.second.first, t.second.second);
+        }
+    }
+    info.num_prologue_blocks = prologue.size();
+    info.num_window_blocks = window.size();
+
+    // the events in the window keep their distance from the window start
+    info.window_start = prologue.size();
+    auto in_window = [&](op_id_t op_id) { return op_id - start + info.window_start; };
+
+    // the frees past the window, in free order
+    std::vector<std::pair<op_id_t, size_t>> late_frees;
+    auto collect_late_frees = [&](const std::vector<std::tuple<op_id_t, op_id_t, size_t>>& kept, size_t offset) {
+        for (size_t i = 0; i < kept.size(); i++) {
+            if (std::get<1>(kept[i]) >= end) {
+                late_frees.emplace_back(std::get<1>(kept[i]), offset + i);
+            }
+        }
+    };
+    collect_late_frees(prologue, 0);
+    collect_late_frees(window, prologue.size());
+    std::sort(late_frees.begin(), late_frees.end());
+    info.num_live_blocks = late_frees.size();
+
+    // the window end in the slice, past its last event
+    op_id_t slice_end = info.window_start;
+    for (auto& w : window) {
+        slice_end = std::max(slice_end, in_window(std::get<0>(w)) + 1);
+        if (std::get<1>(w) < end) {
+            slice_end = std::max(slice_end, in_window(std::get<1>(w)) + 1);
+        }
+    }
+    for (auto& p : prologue) {
+        if (std::get<1>(p) < end) {
+            slice_end = std::max(slice_end, in_window(std::get<1>(p)) + 1);
+        }
+    }
+    std::vector<op_id_t> late_free_op_ids(prologue.size() + window.size());
+    for (size_t i = 0; i < late_frees.size(); i++) {
+        late_free_op_ids[late_frees[i].second] = slice_end + i;
+    }
+
+    for (size_t i = 0; i < prologue.size(); i++) {
+        auto free_op_id = std::get<1>(prologue[i]);
+        out.emplace_hint(out.end(), i, std::make_pair(
+            free_op_id < end ? in_window(free_op_id) : late_free_op_ids[i], std::get<2>(prologue[i])));
+    }
+    for (size_t i = 0; i < window.size(); i++) {
+        auto free_op_id = std::get<1>(window[i]);
+        out.emplace_hint(out.end(), in_window(std::get<0>(window[i])), std::make_pair(
+            free_op_id < end ? in_window(free_op_id) : late_free_op_ids[prologue.size() + i],
+            std::get<2>(window[i])));
+    }
+    return info;
+}
+
+}  // namespace AllocatorSim
+}  // namespace cuda
+}  // namespace c10
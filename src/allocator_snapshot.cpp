@@ -0,0 +1,285 @@
+#include "allocator_snapshot.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <fstream>
+
+namespace c10 {
+namespace cuda {
+namespace AllocatorSim {
+
+namespace {
+    // a forward-only reader of the JSON values in [p, end)
+    struct jsonScanner {
+        const char* p;
+        const char* end;
+
+        void skip_spaces() {
+            while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) {
+                p++;
+            }
+        }
+
+        // true and consumed if the next token is c
+        bool next_is(char c) {
+            skip_spaces();
+            if (p < end && *p == c) {
+                p++;
+                return true;
+            }
+            return false;
+        }
+
+        bool skip_string() {
+            if (!next_is('"')) {
+                return false;
+            }
+            while (p < end && *p != '"') {
+                p += (*p == '\\') ? 2 : 1;
+            }
+            return p++ < end;
+        }
+
+        // escapes are kept as they are, the keys and actions have none
+        bool read_string(std::string& out) {
+            skip_spaces();
+            auto* start = p + 1;
+            if (!skip_string()) {
+                return false;
+            }
+            out.assign(start, p - 1);
+            return true;
+        }
+
+        bool read_int(int64_t& value) {
+            skip_spaces();
+            auto result = std::from_chars(p, end, value);
+            if (result.ec != std::errc()) {
+                return false;
+            }
+            p = result.ptr;
+            // a float is truncated
+            while (p < end && (std::isdigit(static_cast<unsigned char>(*p)) || *p == '.' ||
+                               *p == 'e' || *p == 'E' || *p == '+' || *p == '-')) {
+                p++;
+            }
+            return true;
+        }
+
+        // strings, numbers, literals and nested arrays or objects
+        bool skip_value() {
+            skip_spaces();
+            if (p >= end) {
+                return false;
+            }
+            if (*p == '"') {
+                return skip_string();
+            }
+            if (*p != '[' && *p != '{') {
+                while (p < end && *p != ',' && *p != ']' && *p != '}' && !std::isspace(static_cast<unsigned char>(*p))) {
+                    p++;
+                }
+                return true;
+            }
+            size_t depth = 0;
+            while (p < end) {
+                char c = *p;
+                if (c == '"') {
+                    if (!skip_string()) {
+                        return false;
+                    }
+                    continue;
+                }
+                p++;
+                if (c == '[' || c == '{') {
+                    depth++;
+                } else if ((c == ']' || c == '}') && --depth == 0) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // fn(key) for the members of an object, fn consumes the value
+        template <typename Fn>
+        bool for_each_member(Fn fn) {
+            if (!next_is('{')) {
+                return false;
+            }
+            if (next_is('}')) {
+                return true;
+            }
+            std::string key;
+            do {
+                if (!read_string(key) || !next_is(':') || !fn(key)) {
+                    return false;
+                }
+            } while (next_is(','));
+            return next_is('}');
+        }
+
+        // fn(index) for the elements of an array, fn consumes the element
+        template <typename Fn>
+        bool for_each_element(Fn fn) {
+            if (!next_is('[')) {
+                return false;
+            }
+            if (next_is(']')) {
+                return true;
+            }
+            size_t index = 0;
+            do {
+                if (!fn(index++)) {
+                    return false;
+                }
+            } while (next_is(','));
+            return next_is(']');
+        }
+    };
+
+    struct SnapshotEntry {
+        std::string action;
+        int64_t addr = 0;
+        int64_t size = 0;
+        int64_t stream = 0;
+    };
+}   // anonymous namespace for variables
+
+snapshotImporter::snapshotImporter(int device) : device(device) {}
+
+bool snapshotImporter::import(const std::string& filename,
+                              const std::function<void(const TraceBlock&)>& on_block,
+                              const std::function<void(op_id_t, AllocatorEventType_t)>& on_api,
+                              std::string& error) {
+    mappedFile file(filename);
+    if (!file.is_open()) {
+        error = "cannot read " + filename;
+        return false;
+    }
+    jsonScanner json {file.get_data(), file.get_data() + file.get_length()};
+
+    // <addr, <malloc_op_id, size>>
+    std::unordered_map<int64_t, std::pair<op_id_t, size_t>> live_blocks;
+    op_id_t op_id = 0;
+    bool has_traces = false;
+
+    auto process = [&](const SnapshotEntry& e) {
+        num_entries++;
+        streams.insert(e.stream);
+        if (e.action == "alloc") {
+            auto b = live_blocks.find(e.addr);
+            if (b != live_blocks.end()) {   // the free was not recorded
+                on_block(TraceBlock{b->second.first, op_id++, b->second.second});
+                live_blocks.erase(b);
+            }
+            live_blocks.emplace(e.addr, std::make_pair(op_id++, static_cast<size_t>(e.size)));
+        } else if (e.action == "free_completed" || e.action == "free") {
+            auto b = live_blocks.find(e.addr);
+            if (b == live_blocks.end()) {
+                num_unmatched_frees++;
+                return;
+            }
+            on_block(TraceBlock{b->second.first, op_id++, b->second.second});
+            live_blocks.erase(b);
+        } else if (e.action == "empty_cache") {
+            on_api(op_id++, ALLOCATOR_EMPYT_CACHE);
+        } else if (e.action == "segment_alloc" || e.action == "segment_map" ||
+                   e.action == "segment_free" || e.action == "segment_unmap") {
+            // the segments follow from the policy being simulated, a segment_free is also
+            // an OOM retry or a max_split_size release, so they are only counted
+            num_segment_events++;
+        }
+        // free_requested is followed by free_completed once the streams are done with the block
+    };
+
+    auto read_entry = [&](size_t) {
+        SnapshotEntry e;
+        bool ok = json.for_each_member([&](const std::string& key) {
+            if (key == "action") {
+                return json.read_string(e.action);
+            } else if (key == "addr") {
+                return json.read_int(e.addr);
+            } else if (key == "size") {
+                return json.read_int(e.size);
+            } else if (key == "stream") {
+                return json.read_int(e.stream);
+            }
+            return json.skip_value();
+        });
+        if (ok) {
+            process(e);
+        }
+        return ok;
+    };
+
+    bool parsed = json.for_each_member([&](const std::string& key) {
+        if (key != "device_traces") {
+            return json.skip_value();
+        }
+        has_traces = true;
+        return json.for_each_element([&](size_t index) {
+            if (static_cast<int>(index) != device) {
+                return json.skip_value();
+            }
+            return json.for_each_element(read_entry);
+        });
+    });
+    if (!parsed) {
+        error = "bad snapshot near byte " + std::to_string(json.p - file.get_data());
+        return false;
+    }
+    if (!has_traces) {
+        error = "no device_traces in " + filename + ", record it with _record_memory_history()";
+        return false;
+    }
+    // the caching allocator only reuses a block on the stream it was allocated on, replayed on
+    // one stream the blocks of the others would be shared
+    if (streams.size() > 1) {
+        error = filename + ": device " + std::to_string(device) + " has " + std::to_string(streams.size()) +
+                " streams, only single-stream traces can be replayed";
+        return false;
+    }
+
+    // the live blocks are freed at the end in malloc order, as allocatorMgr::process_trace() does
+    if (!live_blocks.empty()) {
+        std::vector<TraceBlock> blocks;
+        blocks.reserve(live_blocks.size());
+        for (auto& b : live_blocks) {
+            blocks.push_back(TraceBlock{b.second.first, op_id, b.second.second});
+        }
+        std::sort(blocks.begin(), blocks.end(),
+            [](const TraceBlock& a, const TraceBlock& b) { return a.malloc_op_id < b.malloc_op_id; });
+        for (auto& b : blocks) {
+            on_block(b);
+        }
+    }
+    return true;
+}
+
+size_t snapshotImporter::get_num_entries() const {
+    return num_entries;
+}
+
+size_t snapshotImporter::get_num_unmatched_frees() const {
+    return num_unmatched_frees;
+}
+
+size_t snapshotImporter::get_num_segment_events() const {
+    return num_segment_events;
+}
+
+size_t snapshotImporter::get_num_streams() const {
+    return streams.size();
+}
+
+bool snapshotImporter::is_snapshot_file(const std::string& filename) {
+    std::ifstream input(filename);
+    char c;
+    while (input.get(c) && std::isspace(static_cast<unsigned char>(c))) {}
+    return input && c == '{';
+}
+
+}  // namespace AllocatorSim
+}  // namespace cuda
+}  // namespace c10
@@ -0,0 +1,221 @@
+#include "allocator_steady.h"
+#include "allocator_compress.h"
+
+#include <algorithm>
+#include <array>
+
+namespace c10 {
+namespace cuda {
+namespace AllocatorSim {
+
+namespace {
+    // key of the live blocks not freed in the skipped periods, above any distance to a free event
+    const uint64_t KEPT_SLOT_KEY = 1ULL << 63;
+}   // anonymous namespace for variables
+
+bool steadyState::is_repeated(const std::vector<ReplayEvent>& events,
+                              const std::vector<ReplaySlot>& slots, size_t i, size_t j) {
+    auto& a = events[i];
+    auto& b = events[j];
+    if (a.type != b.type) {
+        return false;
+    }
+    // a free takes the live block whose free event it is, so only the mallocs are compared
+    if (a.type != ALLOCATOR_MALLOC_BLOCK) {
+        return true;
+    }
+    auto& sa = slots[a.slot];
+    auto& sb = slots[b.slot];
+    return sa.size == sb.size && sa.has_free_event == sb.has_free_event &&
+        (!sa.has_free_event || sa.free_event - i == sb.free_event - j);
+}
+
+void steadyState::analyze(const std::vector<ReplayEvent>& events, const std::vector<ReplaySlot>& slots,
+                          size_t origin, size_t period_hint) {
+    clear();
+    num_events = events.size();
+
+    std::vector<std::pair<size_t, size_t>> candidates;
+    if (period_hint > 0) {
+        candidates.emplace_back(origin, period_hint);
+    }
+    // mallocs per iteration from the sizes, counted in events in the middle of the trace
+    std::vector<size_t> sizes;
+    std::vector<size_t> malloc_events(slots.size(), std::numeric_limits<size_t>::max());
+    sizes.reserve(slots.size());
+    for (auto& slot : slots) {
+        sizes.push_back(slot.size);
+    }
+    for (size_t i = 0; i < events.size(); i++) {
+        if (events[i].type == ALLOCATOR_MALLOC_BLOCK) {
+            malloc_events[events[i].slot] = i;
+        }
+    }
+    auto num_mallocs = compressedTrace::detect_period(sizes);
+    auto middle = slots.size() / 2;
+    if (num_mallocs < slots.size() && middle + num_mallocs < slots.size() &&
+        malloc_events[middle] < malloc_events[middle + num_mallocs] &&
+        malloc_events[middle + num_mallocs] != std::numeric_limits<size_t>::max()) {
+        candidates.emplace_back(0, malloc_events[middle + num_mallocs] - malloc_events[middle]);
+    }
+
+    for (auto& c : candidates) {
+        if (c.first + 2 * c.second > num_events) {
+            continue;
+        }
+        mismatches.clear();
+        for (size_t i = c.first + c.second; i < num_events; i++) {
+            if (!is_repeated(events, slots, i, i - c.second)) {
+                mismatches.push_back(i);
+            }
+        }
+        // mostly repeated, otherwise the boundaries are not worth checking
+        if (2 * mismatches.size() < num_events - c.first - c.second) {
+            origin = c.first;
+            period = c.second;
+            return;
+        }
+    }
+    mismatches.clear();
+}
+
+void steadyState::clear() {
+    period = 0;
+    origin = 0;
+    num_events = 0;
+    mismatches.clear();
+}
+
+bool steadyState::is_periodic() const {
+    return period > 0;
+}
+
+bool steadyState::is_boundary(size_t i) const {
+    return period > 0 && i >= origin && (i - origin) % period == 0;
+}
+
+size_t steadyState::get_period() const {
+    return period;
+}
+
+size_t steadyState::get_repeated_end(size_t i) const {
+    if (period == 0 || i < origin + period || i >= num_events) {
+        return i;
+    }
+    auto it = std::lower_bound(mismatches.begin(), mismatches.end(), i);
+    auto next = (it == mismatches.end()) ? num_events : *it;
+    // a boundary before the next unlike event, the replay goes on from there
+    return (next > i) ? i + (next - i - 1) / period * period : i;
+}
+
+steadyStateReplay::steadyStateReplay(const steadyState& steady,
+                                     const std::vector<ReplayEvent>& events,
+                                     const std::vector<ReplaySlot>& slots)
+    : steady(steady), events(events), slots(slots), live_index(slots.size(), 0) {}
+
+void steadyStateReplay::on_malloc(uint32_t slot) {
+    live_index[slot] = static_cast<uint32_t>(live_slots.size());
+    live_slots.push_back(slot);
+}
+
+void steadyStateReplay::on_free(uint32_t slot) {
+    auto index = live_index[slot];
+    auto last = live_slots.back();
+    live_slots[index] = last;
+    live_index[last] = index;
+    live_slots.pop_back();
+}
+
+void steadyStateReplay::take_state(std::vector<uint64_t>& state, size_t i, size_t until,
+                                   const allocatorSim& sim, const std::function<Block*&(uint32_t)>& block_of) {
+    state.clear();
+    sim.get_state(state);
+    // the live blocks freed before until by the distance to their free event, so the
+    // same blocks one period later have the same keys, the others keep their slot
+    std::vector<std::array<uint64_t, 4>> blocks;
+    blocks.reserve(live_slots.size());
+    for (auto slot : live_slots) {
+        auto* block = block_of(slot);
+        auto& s = slots[slot];
+        auto key = (s.has_free_event && s.free_event < until) ? s.free_event - i : KEPT_SLOT_KEY | slot;
+        blocks.push_back({key, block->ptr, block->size, block->pool->is_small ? 1ULL : 0ULL});
+    }
+    std::sort(blocks.begin(), blocks.end());
+    for (auto& b : blocks) {
+        state.insert(state.end(), b.begin(), b.end());
+    }
+}
+
+bool steadyStateReplay::move_live_blocks(size_t i, size_t end, const std::function<Block*&(uint32_t)>& block_of) {
+    // <slot, block>: a live block freed before end goes to the slot freed end - i events later
+    std::vector<std::pair<uint32_t, Block*>> moved;
+    for (auto slot : live_slots) {
+        auto& s = slots[slot];
+        if (!s.has_free_event || s.free_event >= end) {
+            continue;
+        }
+        auto free_event = s.free_event + (end - i);
+        if (free_event >= events.size() || events[free_event].type != ALLOCATOR_FREE_BLOCK) {
+            return false;
+        }
+        moved.emplace_back(events[free_event].slot, block_of(slot));
+    }
+
+    size_t count = 0;
+    for (auto slot : live_slots) {
+        auto& s = slots[slot];
+        if (s.has_free_event && s.free_event < end) {
+            block_of(slot) = nullptr;
+        } else {
+            live_slots[count++] = slot;
+        }
+    }
+    live_slots.resize(count);
+    for (auto& m : moved) {
+        block_of(m.first) = m.second;
+        live_slots.push_back(m.first);
+    }
+    for (size_t j = 0; j < live_slots.size(); j++) {
+        live_index[live_slots[j]] = static_cast<uint32_t>(j);
+    }
+    return true;
+}
+
+size_t steadyStateReplay::on_boundary(size_t i, const allocatorSim& sim,
+                                      const std::function<Block*&(uint32_t)>& block_of) {
+    auto period = steady.get_period();
+    auto end = steady.get_repeated_end(i);
+    // a fixed point: the repeated periods from i replay as the one before i did,
+    // so they reach no new peak and end in the state at i
+    if (end > i && prev_boundary != std::numeric_limits<size_t>::max() && prev_boundary + period == i) {
+        take_state(state, i, end, sim, block_of);
+        if (state == prev_state && move_live_blocks(i, end, block_of)) {
+            num_skipped_events += end - i;
+            skipped_op_counts += (sim.get_op_counts() - prev_op_counts) * ((end - i) / period);
+            i = end;
+        }
+    }
+
+    // the state compared at the next boundary, with the blocks it keeps in their slots
+    auto next_end = steady.get_repeated_end(i + period);
+    if (next_end > i + period) {
+        take_state(prev_state, i, next_end - period, sim, block_of);
+        prev_op_counts = sim.get_op_counts();
+        prev_boundary = i;
+    } else {
+        prev_boundary = std::numeric_limits<size_t>::max();
+    }
+    return i;
+}
+
+size_t steadyStateReplay::get_num_skipped_events() const {
+    return num_skipped_events;
+}
+
+const AllocatorOpCounts& steadyStateReplay::get_skipped_op_counts() const {
+    return skipped_op_counts;
+}
+
+}  // namespace AllocatorSim
+}  // namespace cuda
+}  // namespace c10
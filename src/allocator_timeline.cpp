@@ -0,0 +1,112 @@
+#include "allocator_timeline.h"
+
+namespace c10 {
+namespace cuda {
+namespace AllocatorSim {
+
+namespace {
+    // events are flushed in chunks of this size
+    const size_t TIMELINE_BUFFER_SIZE = 1 << 22;
+
+    const int TIMELINE_PID = 0;
+    const int SMALL_POOL_TID = 1;
+    const int LARGE_POOL_TID = 2;
+}   // anonymous namespace for variables
+
+allocatorTimeline::allocatorTimeline(const std::string& filename)
+    : buffer(TIMELINE_BUFFER_SIZE) {
+    output.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+    output.open(filename);
+    output << "[" << std::endl;
+    output << "{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": " << TIMELINE_PID
+           << ", \"tid\": " << SMALL_POOL_TID << ", \"args\": {\"name\": \"small pool\"}}," << std::endl;
+    output << "{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": " << TIMELINE_PID
+           << ", \"tid\": " << LARGE_POOL_TID << ", \"args\": {\"name\": \"large pool\"}}";
+}
+
+allocatorTimeline::~allocatorTimeline() {
+    close();
+}
+
+bool allocatorTimeline::is_open() const {
+    return output.is_open();
+}
+
+void allocatorTimeline::close() {
+    if (!output.is_open()) {
+        return;
+    }
+    output << std::endl << "]" << std::endl;
+    output.close();
+}
+
+size_t allocatorTimeline::get_num_events() const {
+    return num_events;
+}
+
+std::ostream& allocatorTimeline::begin_event(const char* phase, const char* category,
+                                             const char* name, op_id_t op_id) {
+    output << ",\n{\"ph\": \"" << phase << "\", \"cat\": \"" << category
+           << "\", \"name\": \"" << name << "\", \"ts\": " << op_id
+           << ", \"pid\": " << TIMELINE_PID;
+    num_events++;
+    return output;
+}
+
+void allocatorTimeline::end_event() {
+    output << "}";
+}
+
+void allocatorTimeline::segment_create(op_id_t op_id, uint64_t ptr, size_t size, bool is_small) {
+    begin_event("b", "segment", "segment", op_id)
+        << ", \"tid\": " << (is_small ? SMALL_POOL_TID : LARGE_POOL_TID)
+        << ", \"id\": \"0x" << std::hex << ptr << std::dec
+        << "\", \"args\": {\"size\": " << size << "}";
+    end_event();
+}
+
+void allocatorTimeline::segment_release(op_id_t op_id, uint64_t ptr, size_t size) {
+    begin_event("e", "segment", "segment", op_id)
+        << ", \"id\": \"0x" << std::hex << ptr << std::dec
+        << "\", \"args\": {\"size\": " << size << "}";
+    end_event();
+}
+
+void allocatorTimeline::block_allocate(op_id_t op_id, uint64_t ptr, size_t size, size_t orig_size) {
+    begin_event("b", "block", "block", op_id)
+        << ", \"id\": \"0x" << std::hex << ptr << std::dec
+        << "\", \"args\": {\"size\": " << size << ", \"orig_size\": " << orig_size << "}";
+    end_event();
+}
+
+void allocatorTimeline::block_free(op_id_t op_id, uint64_t ptr, size_t size) {
+    begin_event("e", "block", "block", op_id)
+        << ", \"id\": \"0x" << std::hex << ptr << std::dec
+        << "\", \"args\": {\"size\": " << size << "}";
+    end_event();
+}
+
+void allocatorTimeline::block_split(op_id_t op_id, uint64_t ptr, size_t size, size_t remaining_size) {
+    begin_event("i", "block", "split", op_id)
+        << ", \"s\": \"p\", \"args\": {\"ptr\": " << ptr << ", \"size\": " << size
+        << ", \"remaining_size\": " << remaining_size << "}";
+    end_event();
+}
+
+void allocatorTimeline::block_merge(op_id_t op_id, uint64_t ptr, size_t size, size_t subsumed_size) {
+    begin_event("i", "block", "merge", op_id)
+        << ", \"s\": \"p\", \"args\": {\"ptr\": " << ptr << ", \"size\": " << size
+        << ", \"subsumed_size\": " << subsumed_size << "}";
+    end_event();
+}
+
+void allocatorTimeline::memory_counters(op_id_t op_id, size_t allocated_bytes, size_t reserved_bytes) {
+    begin_event("C", "memory", "memory", op_id)
+        << ", \"args\": {\"allocated\": " << allocated_bytes
+        << ", \"reserved\": " << reserved_bytes << "}";
+    end_event();
+}
+
+}  // namespace AllocatorSim
+}  // namespace cuda
+}  // namespace c10
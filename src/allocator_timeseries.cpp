@@ -0,0 +1,204 @@
+#include "allocator_timeseries.h"
+
+#include <fstream>
+
+namespace c10 {
+namespace cuda {
+namespace AllocatorSim {
+
+void SeriesWindow::add(const SeriesSample& sample) {
+    if (num_samples == 0) {
+        first_op_id = sample.op_id;
+        reserved.init(sample.reserved);
+        allocated.init(sample.allocated);
+        segments.init(sample.segments);
+        fragmentation.init(sample.fragmentation);
+    } else {
+        reserved.add(sample.reserved);
+        allocated.add(sample.allocated);
+        segments.add(sample.segments);
+        fragmentation.add(sample.fragmentation);
+    }
+    last_op_id = sample.op_id;
+    num_samples++;
+}
+
+void SeriesWindow::merge(const SeriesWindow& other) {
+    if (other.num_samples == 0) {
+        return;
+    }
+    if (num_samples == 0) {
+        *this = other;
+        return;
+    }
+    reserved.merge(other.reserved);
+    allocated.merge(other.allocated);
+    segments.merge(other.segments);
+    fragmentation.merge(other.fragmentation);
+    last_op_id = other.last_op_id;
+    num_samples += other.num_samples;
+}
+
+allocatorTimeSeries::allocatorTimeSeries(size_t recent_capacity,
+                                         size_t num_levels,
+                                         size_t base_window,
+                                         size_t level_factor,
+                                         size_t level_capacity)
+    : recent(recent_capacity), top_capacity(level_capacity) {
+    size_t window = base_window;
+    for (size_t i = 0; i < num_levels; i++) {
+        levels.emplace_back(window, level_capacity);
+        window *= level_factor;
+    }
+    top_window_samples = window;
+    top_windows.reserve(top_capacity);
+}
+
+void allocatorTimeSeries::record(const SeriesSample& sample) {
+    if (num_samples == 0) {
+        first_op_id = sample.op_id;
+    }
+    num_samples++;
+
+    recent.push(sample);
+
+    for (auto& level : levels) {
+        level.pending.add(sample);
+        if (level.pending.num_samples == level.window_samples) {
+            level.windows.push(level.pending);
+            level.pending = SeriesWindow();
+        }
+    }
+
+    top_pending.add(sample);
+    if (top_pending.num_samples >= top_window_samples) {
+        top_windows.push_back(top_pending);
+        top_pending = SeriesWindow();
+        if (top_windows.size() == top_capacity) {
+            compact_top();
+        }
+    }
+}
+
+void allocatorTimeSeries::compact_top() {
+    size_t count = 0;
+    for (size_t i = 0; i < top_windows.size(); i += 2) {
+        auto window = top_windows[i];
+        if (i + 1 < top_windows.size()) {
+            window.merge(top_windows[i + 1]);
+        }
+        top_windows[count++] = window;
+    }
+    top_windows.resize(count);
+    top_window_samples *= 2;
+}
+
+std::vector<SeriesWindow> allocatorTimeSeries::coarsen(const std::vector<SeriesWindow>& windows,
+                                                      size_t resolution) {
+    std::vector<SeriesWindow> result;
+    SeriesWindow current;
+    for (auto& w : windows) {
+        current.merge(w);
+        if (current.num_samples >= resolution) {
+            result.push_back(current);
+            current = SeriesWindow();
+        }
+    }
+    if (current.num_samples > 0) {
+        result.push_back(current);
+    }
+    return result;
+}
+
+std::vector<SeriesWindow> allocatorTimeSeries::query(size_t resolution,
+                                                     op_id_t begin,
+                                                     op_id_t end) const {
+    std::vector<SeriesWindow> windows;
+    if (num_samples == 0 || begin > end) {
+        return windows;
+    }
+    begin = std::max(begin, first_op_id);
+    auto in_range = [begin, end](const SeriesWindow& w) {
+        return w.num_samples > 0 && w.last_op_id >= begin && w.first_op_id <= end;
+    };
+
+    // raw samples
+    if (resolution < levels.front().window_samples && recent.at(0).op_id <= begin) {
+        for (size_t i = 0; i < recent.size(); i++) {
+            auto& sample = recent.at(i);
+            if (sample.op_id >= begin && sample.op_id <= end) {
+                SeriesWindow w;
+                w.add(sample);
+                windows.push_back(w);
+            }
+        }
+        return coarsen(windows, resolution);
+    }
+
+    // the finest level whose ring still reaches back to begin
+    for (auto& level : levels) {
+        if (level.windows.size() > 0 && level.windows.at(0).first_op_id > begin) {
+            continue;
+        }
+        for (size_t i = 0; i < level.windows.size(); i++) {
+            if (in_range(level.windows.at(i))) {
+                windows.push_back(level.windows.at(i));
+            }
+        }
+        if (in_range(level.pending)) {
+            windows.push_back(level.pending);
+        }
+        if (!windows.empty()) {
+            return coarsen(windows, resolution);
+        }
+    }
+
+    for (auto& w : top_windows) {
+        if (in_range(w)) {
+            windows.push_back(w);
+        }
+    }
+    if (in_range(top_pending)) {
+        windows.push_back(top_pending);
+    }
+    return coarsen(windows, resolution);
+}
+
+const RingBuffer<SeriesSample>& allocatorTimeSeries::get_recent() const {
+    return recent;
+}
+
+size_t allocatorTimeSeries::get_num_samples() const {
+    return num_samples;
+}
+
+void allocatorTimeSeries::clear() {
+    recent.clear();
+    for (auto& level : levels) {
+        level.windows.clear();
+        level.pending = SeriesWindow();
+    }
+    top_windows.clear();
+    top_pending = SeriesWindow();
+    num_samples = 0;
+    first_op_id = 0;
+}
+
+void allocatorTimeSeries::dump(const std::string& filename, size_t resolution) const {
+    std::ofstream output(filename);
+    output << "# first_op_id last_op_id samples"
+           << " reserved(min max last) allocated(min max last)"
+           << " segments(min max last) fragmentation(max last)" << std::endl;
+    for (auto& w : query(resolution)) {
+        output << w.first_op_id << " " << w.last_op_id << " " << w.num_samples << " "
+               << w.reserved.min << " " << w.reserved.max << " " << w.reserved.last << " "
+               << w.allocated.min << " " << w.allocated.max << " " << w.allocated.last << " "
+               << w.segments.min << " " << w.segments.max << " " << w.segments.last << " "
+               << w.fragmentation.max << " " << w.fragmentation.last << std::endl;
+    }
+    output.close();
+}
+
+}  // namespace AllocatorSim
+}  // namespace cuda
+}  // namespace c10
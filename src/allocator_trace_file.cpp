@@ -0,0 +1,426 @@
+#include "allocator_trace_file.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace c10 {
+namespace cuda {
+namespace AllocatorSim {
+
+namespace {
+    // <magic, version, num_sizes, num_blocks, records_bytes>, little endian, version 1 has the
+    // size dictionary before the records, version 2 after them
+    const char TRACE_FILE_MAGIC[8] = {'A', 'S', 'I', 'M', 'T', 'R', 'C', '\0'};
+    const uint32_t TRACE_FILE_VERSION = 2;
+    const uint32_t TRACE_FILE_VERSION_SIZES_FIRST = 1;
+    const size_t TRACE_FILE_HEADER_BYTES = 32;
+    const size_t BINARY_WRITE_BUFFER_BYTES = 1 << 20;
+
+    // text chunks smaller than this are not worth a thread
+    const size_t TEXT_CHUNK_MIN_BYTES = 1 << 20;
+    // for reserving the blocks of a chunk, a line is about 20 bytes in the traces
+    const size_t TEXT_LINE_BYTES_ESTIMATE = 20;
+    const size_t TEXT_WRITE_BUFFER_BYTES = 1 << 20;
+    // three u64 in decimal and their separators
+    const size_t TEXT_LINE_MAX_BYTES = 3 * 21;
+
+    void put_u32(std::vector<uint8_t>& out, uint32_t value) {
+        for (int i = 0; i < 4; i++) {
+            out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+        }
+    }
+
+    void put_u64(std::vector<uint8_t>& out, uint64_t value) {
+        for (int i = 0; i < 8; i++) {
+            out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+        }
+    }
+
+    uint64_t get_u64(const uint8_t* p) {
+        uint64_t value = 0;
+        for (int i = 7; i >= 0; i--) {
+            value = (value << 8) | p[i];
+        }
+        return value;
+    }
+
+    uint32_t get_u32(const uint8_t* p) {
+        return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 |
+            static_cast<uint32_t>(p[2]) << 16 | static_cast<uint32_t>(p[3]) << 24;
+    }
+
+    // deltas and lifetimes are zigzag encoded so an out-of-order trace still round-trips
+    void put_varint(std::vector<uint8_t>& out, uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    bool get_varint(const uint8_t*& p, const uint8_t* end, uint64_t& value) {
+        value = 0;
+        for (int shift = 0; p < end && shift < 64; shift += 7) {
+            uint8_t byte = *p++;
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    uint64_t zigzag(op_id_t from, op_id_t to) {
+        auto diff = static_cast<int64_t>(to - from);
+        return (static_cast<uint64_t>(diff) << 1) ^ static_cast<uint64_t>(diff >> 63);
+    }
+
+    op_id_t unzigzag(op_id_t from, uint64_t value) {
+        return from + static_cast<op_id_t>((value >> 1) ^ (~(value & 1) + 1));
+    }
+}   // anonymous namespace for variables
+
+mappedFile::mappedFile(const std::string& filename) {
+    fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        return;
+    }
+    auto* mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped == MAP_FAILED) {
+        return;
+    }
+    // both readers go through the file once from the front
+    madvise(mapped, st.st_size, MADV_SEQUENTIAL);
+    data = static_cast<const char*>(mapped);
+    length = st.st_size;
+}
+
+mappedFile::~mappedFile() {
+    if (data) {
+        munmap(const_cast<char*>(data), length);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+bool mappedFile::is_open() const {
+    return data != nullptr;
+}
+
+const char* mappedFile::get_data() const {
+    return data;
+}
+
+size_t mappedFile::get_length() const {
+    return length;
+}
+
+bool load_text_trace(const std::string& filename, std::vector<TraceBlock>& blocks,
+                     std::string& error, size_t num_threads) {
+    blocks.clear();
+    mappedFile file(filename);
+    if (!file.is_open()) {
+        error = "cannot read " + filename;
+        return false;
+    }
+    const char* data = file.get_data();
+    const char* data_end = data + file.get_length();
+
+    if (num_threads == 0) {
+        num_threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    }
+    num_threads = std::max<size_t>(std::min(num_threads, file.get_length() / TEXT_CHUNK_MIN_BYTES), 1);
+
+    // chunks start after a newline so no line is split
+    std::vector<const char*> bounds {data};
+    for (size_t t = 1; t < num_threads; t++) {
+        auto* p = std::max(bounds.back(), data + file.get_length() / num_threads * t);
+        p = static_cast<const char*>(std::memchr(p, '\n', data_end - p));
+        bounds.push_back(p ? p + 1 : data_end);
+    }
+    bounds.push_back(data_end);
+
+    std::vector<std::vector<TraceBlock>> chunks(num_threads);
+    std::vector<const char*> bad_lines(num_threads, nullptr);
+    auto parse = [&](size_t t) {
+        auto* p = bounds[t];
+        auto* end = bounds[t + 1];
+        auto& out = chunks[t];
+        out.reserve((end - p) / TEXT_LINE_BYTES_ESTIMATE);
+        while (p < end) {
+            auto* line_end = static_cast<const char*>(std::memchr(p, '\n', end - p));
+            if (!line_end) {
+                line_end = end;
+            }
+            uint64_t values[3];
+            int count = 0;
+            for (auto* q = p; count < 3; count++) {
+                while (q < line_end && (*q == ' ' || *q == '\t')) {
+                    q++;
+                }
+                auto result = std::from_chars(q, line_end, values[count]);
+                if (result.ec != std::errc()) {
+                    break;
+                }
+                q = result.ptr;
+            }
+            if (count == 3) {
+                out.push_back(TraceBlock{values[0], values[1], values[2]});
+            } else if (std::any_of(p, line_end, [](char c) { return !std::isspace(static_cast<unsigned char>(c)); })) {
+                bad_lines[t] = p;
+                return;
+            }
+            p = line_end + 1;
+        }
+    };
+    if (num_threads == 1) {
+        parse(0);
+    } else {
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < num_threads; t++) {
+            threads.emplace_back(parse, t);
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    for (size_t t = 0; t < num_threads; t++) {
+        if (bad_lines[t]) {
+            auto* line_end = static_cast<const char*>(std::memchr(bad_lines[t], '\n', data_end - bad_lines[t]));
+            error = "bad trace line: " + std::string(bad_lines[t], line_end ? line_end : data_end);
+            return false;
+        }
+    }
+    if (num_threads == 1) {
+        blocks.swap(chunks[0]);
+        return true;
+    }
+    size_t num_blocks = 0;
+    for (auto& chunk : chunks) {
+        num_blocks += chunk.size();
+    }
+    blocks.reserve(num_blocks);
+    for (auto& chunk : chunks) {
+        blocks.insert(blocks.end(), chunk.begin(), chunk.end());
+        std::vector<TraceBlock>().swap(chunk);
+    }
+    return true;
+}
+
+textTraceWriter::textTraceWriter(const std::string& filename)
+    : output(filename), buffer(TEXT_WRITE_BUFFER_BYTES) {}
+
+textTraceWriter::~textTraceWriter() {
+    close();
+}
+
+bool textTraceWriter::is_open() const {
+    return output.is_open();
+}
+
+void textTraceWriter::flush() {
+    output.write(buffer.data(), used);
+    used = 0;
+}
+
+void textTraceWriter::add(op_id_t malloc_op_id, op_id_t free_op_id, size_t size) {
+    if (used + TEXT_LINE_MAX_BYTES > buffer.size()) {
+        flush();
+    }
+    auto* p = buffer.data() + used;
+    auto* end = buffer.data() + buffer.size();
+    p = std::to_chars(p, end, malloc_op_id).ptr;
+    *p++ = ' ';
+    p = std::to_chars(p, end, free_op_id).ptr;
+    *p++ = ' ';
+    p = std::to_chars(p, end, size).ptr;
+    *p++ = '\n';
+    used = p - buffer.data();
+}
+
+bool textTraceWriter::close() {
+    if (!output.is_open()) {
+        return false;
+    }
+    flush();
+    output.close();
+    return !output.fail();
+}
+
+binaryTraceWriter::binaryTraceWriter(const std::string& filename)
+    : output(filename, std::ios::binary) {
+    buffer.reserve(BINARY_WRITE_BUFFER_BYTES);
+    // a zero header until close()
+    buffer.resize(TRACE_FILE_HEADER_BYTES, 0);
+    flush();
+}
+
+binaryTraceWriter::~binaryTraceWriter() {
+    close();
+}
+
+bool binaryTraceWriter::is_open() const {
+    return output.is_open();
+}
+
+void binaryTraceWriter::flush() {
+    output.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+    buffer.clear();
+}
+
+void binaryTraceWriter::add(op_id_t malloc_op_id, op_id_t free_op_id, size_t size) {
+    auto index = size_index.emplace(size, static_cast<uint32_t>(sizes.size()));
+    if (index.second) {
+        sizes.push_back(size);
+    }
+    auto used = buffer.size();
+    put_varint(buffer, zigzag(prev_malloc_op_id, malloc_op_id));
+    put_varint(buffer, zigzag(malloc_op_id, free_op_id));
+    put_varint(buffer, index.first->second);
+    num_records_bytes += buffer.size() - used;
+    prev_malloc_op_id = malloc_op_id;
+    num_blocks++;
+    if (buffer.size() >= BINARY_WRITE_BUFFER_BYTES) {
+        flush();
+    }
+}
+
+void binaryTraceWriter::add(const trace_t& blocks) {
+    for (auto& b : blocks) {
+        add(b.first, b.second.first, b.second.second);
+    }
+}
+
+bool binaryTraceWriter::close() {
+    if (!output.is_open()) {
+        return false;
+    }
+    for (auto size : sizes) {
+        put_u64(buffer, size);
+    }
+    flush();
+
+    std::vector<uint8_t> header;
+    header.reserve(TRACE_FILE_HEADER_BYTES);
+    header.insert(header.end(), TRACE_FILE_MAGIC, TRACE_FILE_MAGIC + sizeof(TRACE_FILE_MAGIC));
+    put_u32(header, TRACE_FILE_VERSION);
+    put_u32(header, static_cast<uint32_t>(sizes.size()));
+    put_u64(header, num_blocks);
+    put_u64(header, num_records_bytes);
+    output.seekp(0);
+    output.write(reinterpret_cast<const char*>(header.data()), header.size());
+    output.close();
+    return !output.fail();
+}
+
+uint64_t binaryTraceWriter::get_num_blocks() const {
+    return num_blocks;
+}
+
+size_t binaryTraceWriter::get_file_bytes() const {
+    return TRACE_FILE_HEADER_BYTES + num_records_bytes + sizes.size() * sizeof(uint64_t);
+}
+
+binaryTraceReader::binaryTraceReader(const std::string& filename) : file(filename) {
+    if (!file.is_open() || file.get_length() < TRACE_FILE_HEADER_BYTES) {
+        return;
+    }
+    auto* data = reinterpret_cast<const uint8_t*>(file.get_data());
+    auto length = file.get_length();
+    auto version = get_u32(data + 8);
+    if (std::memcmp(data, TRACE_FILE_MAGIC, sizeof(TRACE_FILE_MAGIC)) != 0 ||
+        (version != TRACE_FILE_VERSION && version != TRACE_FILE_VERSION_SIZES_FIRST)) {
+        return;
+    }
+    uint64_t num_sizes = get_u32(data + 12);
+    auto num_records_bytes = get_u64(data + 24);
+    auto sizes_bytes = num_sizes * sizeof(uint64_t);
+    if (sizes_bytes > length - TRACE_FILE_HEADER_BYTES ||
+        num_records_bytes != length - TRACE_FILE_HEADER_BYTES - sizes_bytes) {
+        return;
+    }
+    auto records_offset = TRACE_FILE_HEADER_BYTES;
+    auto sizes_offset = TRACE_FILE_HEADER_BYTES + num_records_bytes;
+    if (version == TRACE_FILE_VERSION_SIZES_FIRST) {
+        records_offset = TRACE_FILE_HEADER_BYTES + sizes_bytes;
+        sizes_offset = TRACE_FILE_HEADER_BYTES;
+    }
+    sizes.resize(num_sizes);
+    for (uint32_t i = 0; i < num_sizes; i++) {
+        sizes[i] = get_u64(data + sizes_offset + i * sizeof(uint64_t));
+    }
+    num_blocks = get_u64(data + 16);
+    records = data + records_offset;
+    records_end = records + num_records_bytes;
+}
+
+bool binaryTraceReader::is_open() const {
+    return records != nullptr;
+}
+
+bool binaryTraceReader::ok() const {
+    return is_open() && !truncated;
+}
+
+uint64_t binaryTraceReader::get_num_blocks() const {
+    return num_blocks;
+}
+
+size_t binaryTraceReader::get_num_sizes() const {
+    return sizes.size();
+}
+
+binaryTraceReader::iterator binaryTraceReader::begin() const {
+    return is_open() ? iterator(this, records, num_blocks) : end();
+}
+
+binaryTraceReader::iterator binaryTraceReader::end() const {
+    return iterator();
+}
+
+bool binaryTraceReader::is_binary_file(const std::string& filename) {
+    std::ifstream input(filename, std::ios::binary);
+    char magic[sizeof(TRACE_FILE_MAGIC)];
+    return input.read(magic, sizeof(magic)) && std::memcmp(magic, TRACE_FILE_MAGIC, sizeof(magic)) == 0;
+}
+
+binaryTraceReader::iterator::iterator(const binaryTraceReader* reader, const uint8_t* pos, uint64_t remaining)
+    : reader(reader), pos(pos), remaining(remaining + 1) {
+    next();
+}
+
+void binaryTraceReader::iterator::next() {
+    if (remaining == 0 || --remaining == 0) {
+        return;
+    }
+    uint64_t malloc_delta, lifetime, index;
+    if (!get_varint(pos, reader->records_end, malloc_delta) ||
+        !get_varint(pos, reader->records_end, lifetime) ||
+        !get_varint(pos, reader->records_end, index) || index >= reader->sizes.size()) {
+        reader->truncated = true;
+        remaining = 0;
+        return;
+    }
+    block.malloc_op_id = unzigzag(block.malloc_op_id, malloc_delta);
+    block.free_op_id = unzigzag(block.malloc_op_id, lifetime);
+    block.size = reader->sizes[index];
+}
+
+}  // namespace AllocatorSim
+}  // namespace cuda
+}  // namespace c10
@@ -0,0 +1,212 @@
+#include "allocator_tracer.h"
+
+#include <algorithm>
+
+namespace c10 {
+namespace cuda {
+namespace AllocatorSim {
+
+namespace {
+    std::atomic<uint64_t> next_tracer_id{1};
+
+    // <tracer_id, buffer> of the tracers a thread appends to, replaced round-robin,
+    // a thread alternating between a few tracers hits without the registry lock
+    struct ThreadBufferCache {
+        static const size_t NUM_SLOTS = 8;
+
+        uint64_t tracer_ids[NUM_SLOTS] = {};
+        ThreadTraceBuffer* buffers[NUM_SLOTS] = {};
+        size_t next_slot = 0;
+    };
+
+    thread_local ThreadBufferCache thread_buffer_cache;
+}   // anonymous namespace for variables
+
+ThreadTraceBuffer::~ThreadTraceBuffer() {
+    while (head != nullptr) {
+        auto next = head->next.load(std::memory_order_relaxed);
+        delete head;
+        head = next;
+    }
+}
+
+allocatorTracer::allocatorTracer(size_t num_preallocated_chunks, size_t max_chunks)
+    : tracer_id(next_tracer_id.fetch_add(1, std::memory_order_relaxed)), max_chunks(max_chunks) {
+    chunk_pool.reserve(num_preallocated_chunks);
+    for (size_t i = 0; i < num_preallocated_chunks; i++) {
+        chunk_pool.push_back(new TraceChunk());
+    }
+    num_chunks = num_preallocated_chunks;
+}
+
+allocatorTracer::~allocatorTracer() {
+    std::lock_guard<std::mutex> guard(registry_mutex);
+    buffers.clear();
+    std::lock_guard<std::mutex> pool_guard(pool_mutex);
+    for (auto chunk : chunk_pool) {
+        delete chunk;
+    }
+    chunk_pool.clear();
+}
+
+TraceChunk* allocatorTracer::acquire_chunk() {
+    std::lock_guard<std::mutex> guard(pool_mutex);
+    if (UNLIKELY(chunk_pool.empty())) {
+        size_t batch = std::max<size_t>(num_chunks, 1);
+        if (max_chunks != 0) {
+            batch = std::min(batch, max_chunks - std::min(num_chunks, max_chunks));
+            if (batch == 0) {
+                return nullptr;
+            }
+        }
+        for (size_t i = 0; i < batch; i++) {
+            chunk_pool.push_back(new TraceChunk());
+        }
+        num_chunks += batch;
+    }
+    auto chunk = chunk_pool.back();
+    chunk_pool.pop_back();
+    return chunk;
+}
+
+void allocatorTracer::release_chunk(TraceChunk* chunk) {
+    chunk->count.store(0, std::memory_order_relaxed);
+    chunk->next.store(nullptr, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> guard(pool_mutex);
+    chunk_pool.push_back(chunk);
+}
+
+ThreadTraceBuffer* allocatorTracer::register_thread() {
+    auto owner = std::this_thread::get_id();
+    ThreadTraceBuffer* buffer = nullptr;
+    {
+        std::lock_guard<std::mutex> guard(registry_mutex);
+        // evicted from the cache, the thread keeps its buffer
+        for (auto& b : buffers) {
+            if (b->owner == owner) {
+                buffer = b.get();
+                break;
+            }
+        }
+        if (buffer == nullptr) {
+            auto chunk = acquire_chunk();
+            if (chunk == nullptr) {
+                // every thread has a chunk, even beyond max_chunks
+                std::lock_guard<std::mutex> pool_guard(pool_mutex);
+                chunk = new TraceChunk();
+                num_chunks++;
+            }
+            buffer = new ThreadTraceBuffer(chunk, owner);
+            buffers.emplace_back(buffer);
+        }
+    }
+    auto& cache = thread_buffer_cache;
+    auto slot = cache.next_slot;
+    cache.next_slot = (slot + 1) % ThreadBufferCache::NUM_SLOTS;
+    cache.tracer_ids[slot] = tracer_id;
+    cache.buffers[slot] = buffer;
+    return buffer;
+}
+
+ThreadTraceBuffer* allocatorTracer::get_thread_buffer() {
+    auto& cache = thread_buffer_cache;
+    for (size_t i = 0; i < ThreadBufferCache::NUM_SLOTS; i++) {
+        if (cache.tracer_ids[i] == tracer_id) {
+            return cache.buffers[i];
+        }
+    }
+    return register_thread();
+}
+
+bool allocatorTracer::append(op_id_t op_id, void* ptr, int64_t size) {
+    return append_event(get_thread_buffer(), TraceEvent(op_id, ptr, size));
+}
+
+bool allocatorTracer::append(op_id_t op_id, void* ptr, int64_t size, uint64_t callpath, const std::string& text) {
+    auto buffer = get_thread_buffer();
+    // the owner is the only writer, it reads its own table without the lock
+    if (UNLIKELY(buffer->callpaths.find(callpath) == buffer->callpaths.end())) {
+        std::lock_guard<std::mutex> guard(buffer->callpath_mutex);
+        buffer->callpaths.emplace(callpath, text);
+    }
+    return append_event(buffer, TraceEvent(op_id, ptr, size, callpath));
+}
+
+bool allocatorTracer::append_event(ThreadTraceBuffer* buffer, const TraceEvent& event) {
+    auto chunk = buffer->tail;
+    auto n = chunk->count.load(std::memory_order_relaxed);
+    if (UNLIKELY(n == TraceChunk::CAPACITY)) {
+        auto new_chunk = acquire_chunk();
+        if (new_chunk == nullptr) {
+            // the chunk stays full, a later append retries once drain() has freed some
+            num_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        chunk->next.store(new_chunk, std::memory_order_release);
+        buffer->tail = new_chunk;
+        chunk = new_chunk;
+        n = 0;
+    }
+    chunk->events[n] = event;
+    // publish the event to drain()
+    chunk->count.store(n + 1, std::memory_order_release);
+    return true;
+}
+
+std::vector<TraceEvent> allocatorTracer::drain() {
+    std::vector<TraceEvent> events;
+    std::lock_guard<std::mutex> guard(registry_mutex);
+    for (auto& buffer : buffers) {
+        while (true) {
+            auto chunk = buffer->head;
+            auto n = chunk->count.load(std::memory_order_acquire);
+            events.insert(events.end(), chunk->events + buffer->read_pos, chunk->events + n);
+            buffer->read_pos = n;
+            if (n < TraceChunk::CAPACITY) {
+                break;
+            }
+            // the producer has moved on once the next chunk is linked
+            auto next = chunk->next.load(std::memory_order_acquire);
+            if (next == nullptr) {
+                break;
+            }
+            buffer->head = next;
+            buffer->read_pos = 0;
+            release_chunk(chunk);
+        }
+    }
+
+    // each buffer is already ordered, the merge only interleaves threads
+    std::sort(events.begin(), events.end(), [](const TraceEvent& a, const TraceEvent& b) {
+        return a.op_id < b.op_id;
+    });
+    return events;
+}
+
+std::unordered_map<uint64_t, std::string> allocatorTracer::get_callpaths() {
+    std::unordered_map<uint64_t, std::string> callpaths;
+    std::lock_guard<std::mutex> guard(registry_mutex);
+    for (auto& buffer : buffers) {
+        std::lock_guard<std::mutex> callpath_guard(buffer->callpath_mutex);
+        callpaths.insert(buffer->callpaths.begin(), buffer->callpaths.end());
+    }
+    return callpaths;
+}
+
+size_t allocatorTracer::get_num_threads() {
+    std::lock_guard<std::mutex> guard(registry_mutex);
+    return buffers.size();
+}
+
+size_t allocatorTracer::get_num_chunks() {
+    std::lock_guard<std::mutex> guard(pool_mutex);
+    return num_chunks;
+}
+
+uint64_t allocatorTracer::get_num_dropped() const {
+    return num_dropped.load(std::memory_order_relaxed);
+}
+
+}  // namespace AllocatorSim
+}  // namespace cuda
+}  // namespace c10
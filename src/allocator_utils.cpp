@@ -1,6 +1,7 @@
 #include "allocator_utils.h"
 #include <iostream>
 #include <iomanip>
+#include <atomic>
 
 namespace c10 {
 namespace cuda {
@@ -12,7 +13,8 @@ namespace AllocatorSim {
 /******************************************************************************/
 namespace {
 // the op_id is used in the whole code, include simulator and allocator
-op_id_t global_op_id = 0;
+// allocations may come from several threads (dataloader, autograd workers)
+std::atomic<op_id_t> global_op_id{0};
 
 }  // anonymous namespace for variables
 
@@ -21,11 +23,15 @@ op_id_t global_op_id = 0;
 /****************************** Common Functions ******************************/
 /******************************************************************************/
 op_id_t get_global_op_id() {
-    return global_op_id;
+    return global_op_id.load(std::memory_order_relaxed);
 }
 
 void increase_global_op_id() {
-    global_op_id++;
+    global_op_id.fetch_add(1, std::memory_order_relaxed);
+}
+
+op_id_t next_global_op_id() {
+    return global_op_id.fetch_add(1, std::memory_order_relaxed);
 }
 
 std::string format_size(size_t size) {
@@ -113,6 +119,33 @@ void print_sim_mode_controller(SimControlMode_t mode, bool enable) {
     case GROUP_OPTIMIZATION:
         mode_name = "GROUP_OPTIMIZATION";
         break;
+    case MEMORY_PLANNING:
+        mode_name = "MEMORY_PLANNING";
+        break;
+    case TIMELINE_EXPORTING:
+        mode_name = "TIMELINE_EXPORTING";
+        break;
+    case PEAK_ATTRIBUTION:
+        mode_name = "PEAK_ATTRIBUTION";
+        break;
+    case ONLINE_SIMULATION:
+        mode_name = "ONLINE_SIMULATION";
+        break;
+    case BACKGROUND_SEARCH:
+        mode_name = "BACKGROUND_SEARCH";
+        break;
+    case TRACE_COMPRESSION:
+        mode_name = "TRACE_COMPRESSION";
+        break;
+    case STEADY_STATE_DETECTION:
+        mode_name = "STEADY_STATE_DETECTION";
+        break;
+    case SENSITIVITY_ANALYSIS:
+        mode_name = "SENSITIVITY_ANALYSIS";
+        break;
+    case CONFIG_STORE:
+        mode_name = "CONFIG_STORE";
+        break;
     default:
         mode_name = "Unknown mode";
         break;
@@ -177,6 +210,60 @@ void set_sim_control_mode(SimControlMode_t mode, bool enable) {
             SimulatorModeController::set_group_optimization(enable);
             break;
         }
+    case MEMORY_PLANNING:
+        {
+            std::cout << "Set enable_memory_planning to " << std::boolalpha << enable << std::endl;
+            SimulatorModeController::set_memory_planning(enable);
+            break;
+        }
+    case TIMELINE_EXPORTING:
+        {
+            std::cout << "Set enable_timeline_exporting to " << std::boolalpha << enable << std::endl;
+            SimulatorModeController::set_timeline_exporting(enable);
+            break;
+        }
+    case PEAK_ATTRIBUTION:
+        {
+            std::cout << "Set enable_peak_attribution to " << std::boolalpha << enable << std::endl;
+            SimulatorModeController::set_peak_attribution(enable);
+            break;
+        }
+    case ONLINE_SIMULATION:
+        {
+            std::cout << "Set enable_online_simulation to " << std::boolalpha << enable << std::endl;
+            SimulatorModeController::set_online_simulation(enable);
+            break;
+        }
+    case BACKGROUND_SEARCH:
+        {
+            std::cout << "Set enable_background_search to " << std::boolalpha << enable << std::endl;
+            SimulatorModeController::set_background_search(enable);
+            break;
+        }
+    case TRACE_COMPRESSION:
+        {
+            std::cout << "Set enable_trace_compression to " << std::boolalpha << enable << std::endl;
+            SimulatorModeController::set_trace_compression(enable);
+            break;
+        }
+    case STEADY_STATE_DETECTION:
+        {
+            std::cout << "Set enable_steady_state_detection to " << std::boolalpha << enable << std::endl;
+            SimulatorModeController::set_steady_state_detection(enable);
+            break;
+        }
+    case SENSITIVITY_ANALYSIS:
+        {
+            std::cout << "Set enable_sensitivity_analysis to " << std::boolalpha << enable << std::endl;
+            SimulatorModeController::set_sensitivity_analysis(enable);
+            break;
+        }
+    case CONFIG_STORE:
+        {
+            std::cout << "Set enable_config_store to " << std::boolalpha << enable << std::endl;
+            SimulatorModeController::set_config_store(enable);
+            break;
+        }
     default:
         {
             std::cout << "SimulatorModeController: Unknown mode" << std::endl;
@@ -200,6 +287,15 @@ void SimulatorModeController::init() {
     enable_trace_dumpping = false;
     enable_config_optimization = true;
     enable_group_optimization = false;
+    enable_memory_planning = false;
+    enable_timeline_exporting = false;
+    enable_peak_attribution = false;
+    enable_online_simulation = false;
+    enable_background_search = false;
+    enable_trace_compression = false;
+    enable_steady_state_detection = false;
+    enable_sensitivity_analysis = false;
+    enable_config_store = false;
 }
 
 void SimulatorModeController::show() {
@@ -223,6 +319,24 @@ void SimulatorModeController::show() {
                 << enable_config_optimization << std::endl;
     std::cout << std::setw(width) << std::left << "enable_group_optimization: " << std::boolalpha
                 << enable_group_optimization << std::endl;
+    std::cout << std::setw(width) << std::left << "enable_memory_planning: " << std::boolalpha
+                << enable_memory_planning << std::endl;
+    std::cout << std::setw(width) << std::left << "enable_timeline_exporting: " << std::boolalpha
+                << enable_timeline_exporting << std::endl;
+    std::cout << std::setw(width) << std::left << "enable_peak_attribution: " << std::boolalpha
+                << enable_peak_attribution << std::endl;
+    std::cout << std::setw(width) << std::left << "enable_online_simulation: " << std::boolalpha
+                << enable_online_simulation << std::endl;
+    std::cout << std::setw(width) << std::left << "enable_background_search: " << std::boolalpha
+                << enable_background_search << std::endl;
+    std::cout << std::setw(width) << std::left << "enable_trace_compression: " << std::boolalpha
+                << enable_trace_compression << std::endl;
+    std::cout << std::setw(width) << std::left << "enable_steady_state_detection: " << std::boolalpha
+                << enable_steady_state_detection << std::endl;
+    std::cout << std::setw(width) << std::left << "enable_sensitivity_analysis: " << std::boolalpha
+                << enable_sensitivity_analysis << std::endl;
+    std::cout << std::setw(width) << std::left << "enable_config_store: " << std::boolalpha
+                << enable_config_store << std::endl;
 }
 
 bool SimulatorModeController::enable_async_tracing = true;
@@ -297,6 +411,78 @@ void SimulatorModeController::set_group_optimization(bool optimization) {
     enable_group_optimization = optimization;
 }
 
+bool SimulatorModeController::enable_memory_planning = false;
+bool SimulatorModeController::is_memory_planning() {
+    return enable_memory_planning;
+}
+void SimulatorModeController::set_memory_planning(bool planning) {
+    enable_memory_planning = planning;
+}
+
+bool SimulatorModeController::enable_timeline_exporting = false;
+bool SimulatorModeController::is_timeline_exporting() {
+    return enable_timeline_exporting;
+}
+void SimulatorModeController::set_timeline_exporting(bool exporting) {
+    enable_timeline_exporting = exporting;
+}
+
+bool SimulatorModeController::enable_peak_attribution = false;
+bool SimulatorModeController::is_peak_attribution() {
+    return enable_peak_attribution;
+}
+void SimulatorModeController::set_peak_attribution(bool attribution) {
+    enable_peak_attribution = attribution;
+}
+
+bool SimulatorModeController::enable_online_simulation = false;
+bool SimulatorModeController::is_online_simulation() {
+    return enable_online_simulation;
+}
+void SimulatorModeController::set_online_simulation(bool online) {
+    enable_online_simulation = online;
+}
+
+bool SimulatorModeController::enable_background_search = false;
+bool SimulatorModeController::is_background_search() {
+    return enable_background_search;
+}
+void SimulatorModeController::set_background_search(bool background) {
+    enable_background_search = background;
+}
+
+bool SimulatorModeController::enable_trace_compression = false;
+bool SimulatorModeController::is_trace_compression() {
+    return enable_trace_compression;
+}
+void SimulatorModeController::set_trace_compression(bool compression) {
+    enable_trace_compression = compression;
+}
+
+bool SimulatorModeController::enable_steady_state_detection = false;
+bool SimulatorModeController::is_steady_state_detection() {
+    return enable_steady_state_detection;
+}
+void SimulatorModeController::set_steady_state_detection(bool detection) {
+    enable_steady_state_detection = detection;
+}
+
+bool SimulatorModeController::enable_sensitivity_analysis = false;
+bool SimulatorModeController::is_sensitivity_analysis() {
+    return enable_sensitivity_analysis;
+}
+void SimulatorModeController::set_sensitivity_analysis(bool analysis) {
+    enable_sensitivity_analysis = analysis;
+}
+
+bool SimulatorModeController::enable_config_store = false;
+bool SimulatorModeController::is_config_store() {
+    return enable_config_store;
+}
+void SimulatorModeController::set_config_store(bool store) {
+    enable_config_store = store;
+}
+
 }  // namespace sim_control
 
 }  // namespace AllocatorSim
@@ -0,0 +1,312 @@
+#include "allocator_workload.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace c10 {
+namespace cuda {
+namespace AllocatorSim {
+
+namespace {
+    const std::array<std::string, NUMS_OF_WORKLOAD> WORKLOAD_NAMES {
+        "transformer", "cnn", "optimizer", "kv_cache", "random"
+    };
+
+    // head dimension of the transformer and the KV cache
+    const size_t HEAD_SIZE = 64;
+    // master weights and Adam states
+    const size_t FP32_SIZE = 4;
+    // logits of the KV cache decode steps
+    const size_t VOCAB_SIZE = 32000;
+    // CNN channels of the first layer, doubled at every downsampling
+    const size_t CNN_BASE_CHANNELS = 64;
+}   // anonymous namespace for variables
+
+workloadGenerator::workloadGenerator(const WorkloadConfig& config)
+    : config(config), rng_state(config.seed) {}
+
+// splitmix64, the same sequence on every platform unlike the std distributions
+uint64_t workloadGenerator::next_random() {
+    uint64_t z = (rng_state += 0x9e3779b97f4a7c15);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+}
+
+size_t workloadGenerator::uniform(size_t lo, size_t hi) {
+    if (hi <= lo) {
+        return lo;
+    }
+    return lo + next_random() % (hi - lo + 1);
+}
+
+double workloadGenerator::uniform_real() {
+    return static_cast<double>(next_random() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+size_t workloadGenerator::jittered_seq_len() {
+    auto shorter = static_cast<size_t>(config.seq_len * config.seq_jitter * uniform_real());
+    return std::max<size_t>(config.seq_len - shorter, 1);
+}
+
+uint64_t workloadGenerator::malloc_block(size_t size) {
+    if (config.max_events > 0 && op_id >= config.max_events) {
+        stopped = true;
+    }
+    if (stopped) {
+        return NO_BLOCK;
+    }
+    window.push_back(GeneratedBlock{op_id++, NO_BLOCK, std::max<size_t>(size, 1)});
+    return first_handle + window.size() - 1;
+}
+
+void workloadGenerator::free_block(uint64_t handle) {
+    if (stopped || handle == NO_BLOCK || handle < first_handle) {
+        return;
+    }
+    auto& b = window[handle - first_handle];
+    if (b.free_op_id == NO_BLOCK) {
+        b.free_op_id = op_id++;
+    }
+}
+
+void workloadGenerator::emit_window(uint64_t end_handle) {
+    for (; first_handle < end_handle; first_handle++) {
+        auto& b = window.front();
+        if (b.free_op_id == NO_BLOCK) {
+            kept_blocks.push_back(b);
+        } else {
+            on_block(TraceBlock{b.malloc_op_id, b.free_op_id, b.size});
+        }
+        window.pop_front();
+    }
+}
+
+uint64_t workloadGenerator::generate(const std::function<void(const TraceBlock&)>& on_block) {
+    this->on_block = on_block;
+    for (size_t iter = 0; iter < config.num_iterations && !stopped; iter++) {
+        // the blocks of the previous iteration are freed by now, or kept
+        emit_window(iteration_handle);
+        iteration_handle = first_handle + window.size();
+        switch (config.pattern) {
+            case WORKLOAD_TRANSFORMER: transformer_iteration(); break;
+            case WORKLOAD_CNN: cnn_iteration(); break;
+            case WORKLOAD_OPTIMIZER: optimizer_iteration(iter); break;
+            case WORKLOAD_KV_CACHE: kv_cache_iteration(); break;
+            default: random_iteration(); break;
+        }
+    }
+    emit_window(first_handle + window.size());
+
+    for (auto& b : kept_blocks) {
+        on_block(TraceBlock{b.malloc_op_id, op_id++, b.size});
+    }
+    kept_blocks.clear();
+    return op_id;
+}
+
+void workloadGenerator::transformer_iteration() {
+    size_t seq = jittered_seq_len();
+    size_t bsh = config.batch_size * seq * config.hidden_size * config.element_size;
+    size_t heads = std::max<size_t>(config.hidden_size / HEAD_SIZE, 1);
+    size_t scores = config.batch_size * heads * seq * seq * config.element_size;
+    size_t hh = config.hidden_size * config.hidden_size * config.element_size;
+
+    // forward, <ln1, qkv, probs, context, ln2, fc1, gelu, out> saved per layer
+    std::vector<std::vector<uint64_t>> saved(config.num_layers);
+    for (size_t l = 0; l < config.num_layers; l++) {
+        auto& s = saved[l];
+        s.push_back(malloc_block(bsh));
+        s.push_back(malloc_block(3 * bsh));
+        auto raw_scores = malloc_block(scores);
+        s.push_back(malloc_block(scores));
+        free_block(raw_scores);
+        s.push_back(malloc_block(bsh));
+        s.push_back(malloc_block(bsh));
+        s.push_back(malloc_block(4 * bsh));
+        s.push_back(malloc_block(4 * bsh));
+        s.push_back(malloc_block(bsh));
+    }
+
+    // backward, the weight grads are freed after the optimizer step
+    std::vector<uint64_t> weight_grads;
+    auto grad = malloc_block(bsh);
+    for (size_t l = config.num_layers; l-- > 0;) {
+        auto& s = saved[l];
+        auto d_fc = malloc_block(4 * bsh);
+        weight_grads.push_back(malloc_block(4 * hh));
+        weight_grads.push_back(malloc_block(4 * hh));
+        free_block(s[7]);
+        free_block(s[6]);
+        free_block(s[5]);
+        free_block(d_fc);
+        auto d_probs = malloc_block(scores);
+        weight_grads.push_back(malloc_block(3 * hh));
+        weight_grads.push_back(malloc_block(hh));
+        free_block(s[4]);
+        free_block(s[3]);
+        free_block(s[2]);
+        free_block(d_probs);
+        free_block(s[1]);
+        free_block(s[0]);
+        auto next_grad = malloc_block(bsh);
+        free_block(grad);
+        grad = next_grad;
+    }
+    free_block(grad);
+    for (auto g : weight_grads) {
+        free_block(g);
+    }
+}
+
+void workloadGenerator::cnn_iteration() {
+    size_t side = jittered_seq_len();
+    size_t channels = CNN_BASE_CHANNELS;
+    size_t stage = std::max<size_t>(config.num_layers / 4, 1);
+
+    // forward, <conv, bn + relu> saved per layer
+    std::vector<std::pair<uint64_t, uint64_t>> saved;
+    std::vector<size_t> activations;
+    std::vector<size_t> weights;
+    for (size_t l = 0; l < config.num_layers; l++) {
+        size_t in_channels = channels;
+        if (l > 0 && l % stage == 0) {
+            side = std::max<size_t>(side / 2, 1);
+            channels *= 2;
+        }
+        size_t activation = config.batch_size * channels * side * side * config.element_size;
+        activations.push_back(activation);
+        weights.push_back(in_channels * channels * 9 * config.element_size);
+        auto workspace = malloc_block(uniform(activation / 8, activation));
+        auto conv = malloc_block(activation);
+        free_block(workspace);
+        saved.emplace_back(conv, malloc_block(activation));
+    }
+
+    // backward, the weight grads are freed after the optimizer step
+    std::vector<uint64_t> weight_grads;
+    uint64_t grad = NO_BLOCK;
+    for (size_t l = config.num_layers; l-- > 0;) {
+        auto activation = activations[l];
+        auto d_relu = malloc_block(activation);
+        free_block(saved[l].second);
+        free_block(grad);
+        auto workspace = malloc_block(uniform(activation / 8, activation));
+        weight_grads.push_back(malloc_block(weights[l]));
+        grad = malloc_block(activation);
+        free_block(workspace);
+        free_block(saved[l].first);
+        free_block(d_relu);
+    }
+    free_block(grad);
+    for (auto g : weight_grads) {
+        free_block(g);
+    }
+}
+
+void workloadGenerator::optimizer_iteration(size_t iter) {
+    size_t hh = config.hidden_size * config.hidden_size;
+    const std::array<size_t, 6> params_per_layer {3 * hh, hh, 4 * hh, 4 * hh,
+                                                  config.hidden_size, config.hidden_size};
+
+    // the params, their fp32 master copies and Adam states are never freed
+    if (iter == 0) {
+        for (size_t l = 0; l < config.num_layers; l++) {
+            for (auto n : params_per_layer) {
+                malloc_block(n * config.element_size);
+                malloc_block(n * FP32_SIZE);
+                malloc_block(n * FP32_SIZE);
+                malloc_block(n * FP32_SIZE);
+            }
+        }
+    }
+
+    // grads in backward order, then a step with an fp32 temporary per param
+    std::vector<std::pair<uint64_t, size_t>> grads;
+    for (size_t l = config.num_layers; l-- > 0;) {
+        for (auto n = params_per_layer.rbegin(); n != params_per_layer.rend(); n++) {
+            grads.emplace_back(malloc_block(*n * config.element_size), *n);
+        }
+    }
+    for (auto& g : grads) {
+        auto update = malloc_block(g.second * FP32_SIZE);
+        free_block(update);
+    }
+    for (auto& g : grads) {
+        free_block(g.first);
+    }
+}
+
+void workloadGenerator::kv_cache_iteration() {
+    if (kv_requests.empty()) {
+        kv_requests.resize(config.batch_size);
+    }
+    size_t token_kv = 2 * config.hidden_size * config.element_size;
+    size_t hidden = config.hidden_size * config.element_size;
+
+    for (auto& r : kv_requests) {
+        if (r.remaining == 0) {
+            // prefill of a new request
+            size_t prompt = uniform(1, std::max<size_t>(config.seq_len / 2, 1));
+            r.remaining = uniform(1, std::max<size_t>(config.seq_len - prompt, 1));
+            r.length = prompt;
+            r.layers.assign(config.num_layers, NO_BLOCK);
+            for (auto& kv : r.layers) {
+                auto activation = malloc_block(prompt * hidden);
+                kv = malloc_block(prompt * token_kv);
+                free_block(activation);
+            }
+            continue;
+        }
+        // decode, the cache of a layer is concatenated with the new token
+        r.length++;
+        for (auto& kv : r.layers) {
+            auto grown = malloc_block(r.length * token_kv);
+            free_block(kv);
+            kv = grown;
+        }
+        if (--r.remaining == 0) {
+            for (auto kv : r.layers) {
+                free_block(kv);
+            }
+        }
+    }
+
+    // logits and sampling of the batch
+    auto logits = malloc_block(config.batch_size * VOCAB_SIZE * config.element_size);
+    auto probs = malloc_block(config.batch_size * VOCAB_SIZE * FP32_SIZE);
+    free_block(logits);
+    free_block(probs);
+}
+
+void workloadGenerator::random_iteration() {
+    // log-uniform sizes, geometric lifetimes capped to stay within the next iteration
+    double log_min = std::log(static_cast<double>(std::max<size_t>(config.min_size, 1)));
+    double log_max = std::log(static_cast<double>(std::max(config.max_size, config.min_size)));
+    double p = 1.0 / std::max(config.mean_lifetime, 1.0);
+    for (size_t i = 0; i < config.blocks_per_iteration; i++) {
+        while (!pending_frees.empty() && pending_frees.top().first <= num_mallocs) {
+            free_block(pending_frees.top().second);
+            pending_frees.pop();
+        }
+        auto size = static_cast<size_t>(std::exp(log_min + (log_max - log_min) * uniform_real()));
+        auto lifetime = static_cast<uint64_t>(std::log(1.0 - uniform_real()) / std::log(1.0 - std::min(p, 0.999999)));
+        lifetime = std::min<uint64_t>(lifetime + 1, config.blocks_per_iteration);
+        pending_frees.emplace(num_mallocs + lifetime, malloc_block(size));
+        num_mallocs++;
+    }
+}
+
+bool workloadGenerator::parse_pattern(const std::string& name, WorkloadPattern_t& pattern) {
+    for (size_t i = 0; i < WORKLOAD_NAMES.size(); i++) {
+        if (WORKLOAD_NAMES[i] == name) {
+            pattern = static_cast<WorkloadPattern_t>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace AllocatorSim
+}  // namespace cuda
+}  // namespace c10
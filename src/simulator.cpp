@@ -2,92 +2,568 @@
 #include <fstream>
 #include <algorithm>
 #include <string>
-#include <tuple>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <charconv>
+#include <cmath>
+
+#include <pybind11/embed.h>
 
 #include "allocator_manager.h"
+#include "allocator_snapshot.h"
+#include "allocator_workload.h"
+#include "allocator_slice.h"
 
 using trace_type_t = c10::cuda::AllocatorSim::trace_t;
-using trace_type = std::map<uint64_t, std::pair<uint64_t, size_t>>;
+using api_trace_type_t = std::map<uint64_t, c10::cuda::AllocatorSim::AllocatorEventType_t>;
+
+using on_block_t = std::function<void(const c10::cuda::AllocatorSim::TraceBlock&)>;
+
+// a whole command line value as a number of the type of value, which is left unchanged if v is
+// not one, is negative for an unsigned type, is out of range or is not finite
+template <typename T>
+bool parse_number(const std::string& v, T& value) {
+    T parsed;
+    auto result = std::from_chars(v.data(), v.data() + v.size(), parsed);
+    if (v.empty() || result.ec != std::errc() || result.ptr != v.data() + v.size()) {
+        return false;
+    }
+    if constexpr (std::is_floating_point<T>::value) {
+        if (!std::isfinite(parsed)) {
+            return false;
+        }
+    }
+    value = parsed;
+    return true;
+}
+
+// a setter of a key=value option, false if the value is bad
+using option_setter_t = std::function<bool(const std::string&)>;
+
+template <typename T>
+option_setter_t number_setter(T& field) {
+    return [&field](const std::string& v) { return parse_number(v, field); };
+}
+
+// blocks of a text, binary, compressed or snapshot trace in file order, passed to on_block
+// as they are decoded, only a snapshot has api events
+bool load_trace(const std::string& filename, const on_block_t& on_block, api_trace_type_t& api_trace, int device = 0) {
+    if (c10::cuda::AllocatorSim::snapshotImporter::is_snapshot_file(filename)) {
+        c10::cuda::AllocatorSim::snapshotImporter importer(device);
+        std::string error;
+        size_t num_blocks = 0;
+        bool imported = importer.import(filename,
+            [&on_block, &num_blocks](const c10::cuda::AllocatorSim::TraceBlock& b) {
+                on_block(b);
+                num_blocks++;
+            },
+            [&api_trace](uint64_t op_id, c10::cuda::AllocatorSim::AllocatorEventType_t type) {
+                api_trace.emplace(op_id, type);
+            },
+            error);
+        if (!imported) {
+            std::cout << "[load_trace()] " << error << std::endl;
+            return false;
+        }
+        std::cout << "[load_trace()] device " << device << ": " << importer.get_num_entries() << " entries, "
+                  << num_blocks << " blocks, " << api_trace.size() << " empty_cache, "
+                  << importer.get_num_streams() << " streams, " << importer.get_num_unmatched_frees()
+                  << " frees of earlier blocks" << std::endl;
+    } else if (c10::cuda::AllocatorSim::binaryTraceReader::is_binary_file(filename)) {
+        c10::cuda::AllocatorSim::binaryTraceReader reader(filename);
+        if (!reader.is_open()) {
+            std::cout << "[load_trace()] " << filename << ": bad header or unknown version" << std::endl;
+            return false;
+        }
+        // the records are decoded from the mapped file, nothing is buffered
+        uint64_t num_blocks = 0;
+        for (auto& b : reader) {
+            on_block(b);
+            num_blocks++;
+        }
+        if (!reader.ok() || num_blocks != reader.get_num_blocks()) {
+            std::cout << "[load_trace()] " << filename << ": " << num_blocks << " of "
+                      << reader.get_num_blocks() << " blocks read, the records are truncated" << std::endl;
+            return false;
+        }
+    } else if (c10::cuda::AllocatorSim::compressedTrace::is_compressed_file(filename)) {
+        c10::cuda::AllocatorSim::compressedTrace trace;
+        std::string error;
+        if (!trace.load(filename, error)) {
+            std::cout << "[load_trace()] " << error << std::endl;
+            return false;
+        }
+        trace.for_each_block([&on_block](uint64_t malloc_op_id, uint64_t free_op_id, size_t size) {
+            on_block(c10::cuda::AllocatorSim::TraceBlock{malloc_op_id, free_op_id, size});
+        });
+    } else {
+        std::vector<c10::cuda::AllocatorSim::TraceBlock> blocks;
+        std::string error;
+        if (!c10::cuda::AllocatorSim::load_text_trace(filename, blocks, error)) {
+            std::cout << "[load_trace()] " << error << std::endl;
+            return false;
+        }
+        for (auto& b : blocks) {
+            on_block(b);
+        }
+    }
+    return true;
+}
 
-std::vector<size_t> split_line(std::string str, const std::string c) {
-    std::vector<size_t> vec;
+// false if the trace cannot be loaded, block_map may hold some of its blocks then
+bool process_trace(std::string filename, trace_type_t& block_map) {
+    api_trace_type_t api_trace;
+    // the first block of an op_id is kept
+    return load_trace(filename, [&block_map](const c10::cuda::AllocatorSim::TraceBlock& b) {
+        block_map.emplace_hint(block_map.end(), b.malloc_op_id, std::make_pair(b.free_op_id, b.size));
+    }, api_trace);
+}
 
-    std::string::size_type pos1, pos2;
-    pos1 = 0;
-    pos2 = str.find(c);
-    while (pos2 != std::string::npos) {
-        vec.push_back(std::stol(str.substr(pos1, pos2 - pos1)));
+// renumber the slots and api_trace in place by merging their events in op_id order, as collect_trace()
+// and collect_api() would number them, the op_ids without an event are skipped
+void generate_trace(std::vector<c10::cuda::AllocatorSim::ReplaySlot>& slots, api_trace_type_t& api_trace) {
+    using c10::cuda::AllocatorSim::ReplaySlot;
+    const uint64_t UNFREED = std::numeric_limits<uint64_t>::max();
 
-        pos1 = pos2 + c.size();
-        pos2 = str.find(c, pos1);
+    // the first block of a malloc op_id is kept
+    auto by_malloc = [](const ReplaySlot& a, const ReplaySlot& b) { return a.malloc_op_id < b.malloc_op_id; };
+    if (!std::is_sorted(slots.begin(), slots.end(), by_malloc)) {
+        std::stable_sort(slots.begin(), slots.end(), by_malloc);
     }
+    slots.erase(std::unique(slots.begin(), slots.end(),
+        [](const ReplaySlot& a, const ReplaySlot& b) { return a.malloc_op_id == b.malloc_op_id; }), slots.end());
 
-    if (pos1 != str.length()) {
-        vec.push_back(std::stol(str.substr(pos1)));
+    // the first block of a free op_id takes the free event, the others stay live
+    std::vector<size_t> frees(slots.size());
+    for (size_t i = 0; i < slots.size(); i++) {
+        frees[i] = i;
     }
+    auto by_free = [&slots](size_t a, size_t b) { return slots[a].free_op_id < slots[b].free_op_id; };
+    if (!std::is_sorted(frees.begin(), frees.end(), by_free)) {
+        std::stable_sort(frees.begin(), frees.end(), by_free);
+    }
+    frees.erase(std::unique(frees.begin(), frees.end(),
+        [&slots](size_t a, size_t b) { return slots[a].free_op_id == slots[b].free_op_id; }), frees.end());
 
-    return vec;
+    // a malloc goes before a free of the same op_id, a free before an api event, the free op_ids
+    // are read through frees while the slots are renumbered, so the new ones are kept aside
+    std::vector<uint64_t> free_op_ids(slots.size(), UNFREED);
+    api_trace_type_t renumbered_api_trace;
+    auto api = api_trace.begin();
+    size_t m = 0;
+    for (size_t f = 0; m < slots.size() || f < frees.size() || api != api_trace.end();) {
+        auto next_malloc = (m < slots.size()) ? slots[m].malloc_op_id : UNFREED;
+        auto next_free = (f < frees.size()) ? slots[frees[f]].free_op_id : UNFREED;
+        auto op_id = c10::cuda::AllocatorSim::next_global_op_id();
+        if (m < slots.size() && next_malloc <= next_free && (api == api_trace.end() || next_malloc <= api->first)) {
+            slots[m++].malloc_op_id = op_id;
+        } else if (f < frees.size() && (api == api_trace.end() || next_free <= api->first)) {
+            // a free before its malloc is dropped
+            if (frees[f] < m) {
+                free_op_ids[frees[f]] = op_id;
+            }
+            f++;
+        } else {
+            renumbered_api_trace.emplace(op_id, api->second);
+            api++;
+        }
+    }
+    api_trace.swap(renumbered_api_trace);
+
+    // the live blocks are freed at the end, as allocatorMgr::process_trace() does
+    bool close_live_blocks = !c10::cuda::AllocatorSim::sim_control::SimulatorModeController::is_static_tensor_analysis();
+    auto end_op_id = c10::cuda::AllocatorSim::get_global_op_id();
+    bool has_live_blocks = false;
+    size_t count = 0;
+    for (size_t i = 0; i < slots.size(); i++) {
+        if (free_op_ids[i] == UNFREED) {
+            has_live_blocks = true;
+            if (!close_live_blocks) {
+                continue;
+            }
+            free_op_ids[i] = end_op_id;
+        }
+        slots[i].free_op_id = free_op_ids[i];
+        slots[count++] = slots[i];
+    }
+    slots.erase(slots.begin() + count, slots.end());
+    if (has_live_blocks && close_live_blocks) {
+        c10::cuda::AllocatorSim::increase_global_op_id();
+    }
+}
+
+bool run_allocator(const std::string& trace_file) {
+    using clock = std::chrono::steady_clock;
+    auto seconds = [](clock::time_point start, clock::time_point end) {
+        return std::chrono::duration<double>(end - start).count();
+    };
+
+    c10::cuda::AllocatorSim::allocatorMgr alloc_mgr;
+
+    auto start = clock::now();
+    // the blocks are decoded into the replay slots, renumbered in place and replayed from there
+    std::vector<c10::cuda::AllocatorSim::ReplaySlot> slots;
+    api_trace_type_t api_trace;
+    if (!load_trace(trace_file, [&slots](const c10::cuda::AllocatorSim::TraceBlock& b) {
+            slots.emplace_back(b.malloc_op_id, b.free_op_id, b.size);
+        }, api_trace)) {
+        return false;
+    }
+    auto loaded = clock::now();
+    generate_trace(slots, api_trace);
+    auto num_blocks = slots.size();
+    auto generated = clock::now();
+    alloc_mgr.test_simulator(std::move(slots), std::move(api_trace));
+    auto simulated = clock::now();
+
+    std::cout << "[run_allocator()] " << num_blocks << " blocks, load: " << seconds(start, loaded)
+              << " s, preprocess: " << seconds(loaded, generated)
+              << " s, simulate: " << seconds(generated, simulated) << " s" << std::endl;
+    return true;
 }
 
-std::pair<uint64_t, uint64_t> process_trace(std::string filename, trace_type_t& block_map) {
-    std::ifstream file;
-    file.open(filename);
-    std::string line;
-    while (getline(file, line)) {
-        auto vec = split_line(line, " ");
-        block_map.emplace(vec[0], std::make_pair(vec[1], vec[2]));
+// per-event cost of collect_trace() in async mode, against pairing the events in std::maps on the hot path
+void bench_collect_trace(size_t num_events, size_t num_threads) {
+    using clock = std::chrono::steady_clock;
+    if (num_events == 0) {
+        std::cout << "num_events must be positive" << std::endl;
+        return;
     }
-    file.close();
+    // frees lag mallocs by this many events, at most all of them
+    const size_t live_window = std::min<size_t>(64, num_events);
+    const uint64_t ptr_base = 0x100000000;
+
+    auto ns_per_event = [](clock::time_point start, size_t events) {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count();
+        return static_cast<double>(ns) / events;
+    };
 
-    uint64_t min = std::numeric_limits<uint64_t>::max();
-    uint64_t max = 0;
-    std::for_each(block_map.begin(), block_map.end(),
-    [&min, &max](std::pair<uint64_t, std::pair<uint64_t, size_t>> p) {
-        if (std::get<0>(p) < min) {
-            min = std::get<0>(p);
+    // map-based collection, as done before the per-thread tracer
+    {
+        std::map<void*, std::pair<uint64_t, int64_t>> active_blocks;
+        trace_type_t block_trace;
+        uint64_t op_id = 0;
+        auto start = clock::now();
+        for (size_t i = 0; i < num_events; i++) {
+            auto ptr = reinterpret_cast<void*>(ptr_base + i * 512);
+            active_blocks.emplace(ptr, std::make_pair(op_id++, 512));
+            if (i >= live_window) {
+                auto b = active_blocks.find(reinterpret_cast<void*>(ptr_base + (i - live_window) * 512));
+                block_trace.emplace(b->second.first, std::make_pair(op_id++, b->second.second));
+                active_blocks.erase(b);
+            }
         }
-        if (std::get<0>(std::get<1>(p)) > max) {
-            max = std::get<0>(std::get<1>(p));
+        std::cout << "map-based collection: " << ns_per_event(start, 2 * num_events - live_window)
+                  << " ns/event" << std::endl;
+    }
+
+    // the default path takes the callpath of each malloc, which reads the python frames
+    pybind11::scoped_interpreter interpreter;
+    c10::cuda::AllocatorSim::allocatorMgr alloc_mgr;
+    // the trace collection with the callpaths, but no search at the monitored iteration
+    c10::cuda::AllocatorSim::sim_control::SimulatorModeController::set_profiling(true);
+    c10::cuda::AllocatorSim::sim_control::SimulatorModeController::set_config_optimization(false);
+    c10::cuda::AllocatorSim::sim_control::SimulatorModeController::set_group_optimization(false);
+    // the collecting threads take the GIL for their python states
+    pybind11::gil_scoped_release release;
+
+    // each iteration collects num_events mallocs per thread, the first one warms up the chunk pool
+    const size_t num_iterations = 4;
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t started_iteration = 0;
+    size_t num_finished = 0;
+
+    auto run = [&, num_events, live_window, ptr_base](size_t tid) {
+        uint64_t base = ptr_base * (tid + 1);
+        for (size_t iter = 1; iter <= num_iterations; iter++) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [&] { return started_iteration == iter; });
+            }
+            for (size_t i = 0; i < num_events; i++) {
+                alloc_mgr.collect_trace(reinterpret_cast<void*>(base + i * 512), 512);
+                if (i >= live_window) {
+                    alloc_mgr.collect_trace(reinterpret_cast<void*>(base + (i - live_window) * 512), -512);
+                }
+            }
+            for (size_t i = num_events - live_window; i < num_events; i++) {
+                alloc_mgr.collect_trace(reinterpret_cast<void*>(base + i * 512), -512);
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                num_finished++;
+            }
+            cv.notify_all();
         }
-    });
+    };
 
-    return std::make_pair(min, max);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < num_threads; t++) {
+        threads.emplace_back(run, t);
+    }
+    for (size_t iter = 1; iter <= num_iterations; iter++) {
+        auto start = clock::now();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            started_iteration = iter;
+            num_finished = 0;
+        }
+        cv.notify_all();
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&] { return num_finished == num_threads; });
+        }
+        std::cout << "tracer collection, iteration " << iter << " (" << num_threads << " threads): "
+                  << ns_per_event(start, 2 * num_events) << " ns/event per thread" << std::endl;
+        // only marks the boundary, the iteration of the monitored ones also pairs and replays the trace
+        start = clock::now();
+        alloc_mgr.iteration_trigger(false);
+        std::cout << "iteration end: " << std::chrono::duration_cast<std::chrono::microseconds>(
+                         clock::now() - start).count() << " us" << std::endl;
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
 }
 
-void generate_trace(const trace_type_t& block_map, trace_type& malloc_map, trace_type& free_map) {
-    uint64_t ptr = c10::cuda::AllocatorSim::allocatorConf::get_memory_segment_address_start();
-    uint64_t interval = c10::cuda::AllocatorSim::allocatorConf::get_memory_segment_address_interval();
+// convert a trace to the iteration-periodic compressed format
+bool compress_trace(const std::string& trace_file, const std::string& output_file) {
+    trace_type_t block_map;
+    if (!process_trace(trace_file, block_map)) {
+        return false;
+    }
 
-    std::for_each(block_map.begin(), block_map.end(),
-    [&malloc_map, &free_map, &ptr, &interval](std::pair<uint64_t, std::pair<uint64_t, size_t>> p) {
-        malloc_map.emplace(p.first, std::make_pair(ptr, p.second.second));
-        free_map.emplace(p.second.first, std::make_pair(ptr, p.second.second));
-        ptr += interval;
-    });
+    c10::cuda::AllocatorSim::compressedTrace trace;
+    trace.encode(block_map);
+    trace.dump(output_file);
+
+    trace_type_t decoded;
+    trace.decode(decoded);
+    std::cout << "blocks: " << block_map.size() << ", iterations: " << trace.get_num_iterations()
+              << ", patches: " << trace.get_num_patches()
+              << ", lossless: " << std::boolalpha << (decoded == block_map) << std::endl;
+    std::cout << "file size: " << fs::file_size(trace_file) << " B => " << fs::file_size(output_file)
+              << " B" << std::endl;
+    return true;
 }
 
-void run_allocator(const trace_type& malloc_map, const trace_type& free_map, uint64_t min, uint64_t max) {
-    c10::cuda::AllocatorSim::allocatorMgr alloc_mgr;
+// convert a trace to the binary format
+bool write_binary_trace(const std::string& trace_file, const std::string& output_file) {
+    trace_type_t block_map;
+    if (!process_trace(trace_file, block_map)) {
+        return false;
+    }
+
+    c10::cuda::AllocatorSim::binaryTraceWriter writer(output_file);
+    writer.add(block_map);
+    if (!writer.close()) {
+        std::cout << "cannot write " << output_file << std::endl;
+        return false;
+    }
+
+    trace_type_t decoded;
+    if (!process_trace(output_file, decoded)) {
+        return false;
+    }
+    c10::cuda::AllocatorSim::binaryTraceReader reader(output_file);
+    std::cout << "blocks: " << block_map.size() << ", sizes: " << reader.get_num_sizes()
+              << ", lossless: " << std::boolalpha << (decoded == block_map) << std::endl;
+    std::cout << "file size: " << fs::file_size(trace_file) << " B => " << fs::file_size(output_file)
+              << " B" << std::endl;
+    return true;
+}
+
+// convert a PyTorch memory snapshot to the binary format
+bool import_snapshot(const std::string& snapshot_file, const std::string& output_file, int device) {
+    std::vector<c10::cuda::AllocatorSim::TraceBlock> blocks;
+    api_trace_type_t api_trace;
+    if (!load_trace(snapshot_file, [&blocks](const c10::cuda::AllocatorSim::TraceBlock& b) { blocks.push_back(b); },
+                    api_trace, device)) {
+        return false;
+    }
+    std::sort(blocks.begin(), blocks.end(),
+        [](const c10::cuda::AllocatorSim::TraceBlock& a, const c10::cuda::AllocatorSim::TraceBlock& b) {
+            return a.malloc_op_id < b.malloc_op_id;
+        });
 
-    for (uint64_t i = min; i <= max; i++) {
-        auto alloc = malloc_map.find(i);
-        if (alloc != malloc_map.end()) {
-            alloc_mgr.collect_trace(
-                reinterpret_cast<void*>(alloc->second.first), static_cast<int64_t>(alloc->second.second));
+    c10::cuda::AllocatorSim::binaryTraceWriter writer(output_file);
+    for (auto& b : blocks) {
+        writer.add(b.malloc_op_id, b.free_op_id, b.size);
+    }
+    if (!writer.close()) {
+        std::cout << "cannot write " << output_file << std::endl;
+        return false;
+    }
+    if (!api_trace.empty()) {
+        std::cout << "the binary format keeps no empty_cache, replay the snapshot to include them" << std::endl;
+    }
+    std::cout << "file size: " << fs::file_size(snapshot_file) << " B => " << fs::file_size(output_file)
+              << " B" << std::endl;
+    return true;
+}
+
+// write a synthetic trace, options are key=value, a .bin output is in the binary format
+bool generate_workload(const std::string& pattern, const std::string& output_file,
+                       const std::vector<std::string>& options) {
+    c10::cuda::AllocatorSim::WorkloadConfig config;
+    if (!c10::cuda::AllocatorSim::workloadGenerator::parse_pattern(pattern, config.pattern)) {
+        std::cout << "unknown pattern " << pattern << ", one of transformer, cnn, optimizer, kv_cache, random"
+                  << std::endl;
+        return false;
+    }
+    const std::map<std::string, option_setter_t> setters {
+        {"seed", number_setter(config.seed)},
+        {"iterations", number_setter(config.num_iterations)},
+        {"events", number_setter(config.max_events)},
+        {"layers", number_setter(config.num_layers)},
+        {"batch", number_setter(config.batch_size)},
+        {"seq", number_setter(config.seq_len)},
+        {"hidden", number_setter(config.hidden_size)},
+        {"element", number_setter(config.element_size)},
+        {"jitter", number_setter(config.seq_jitter)},
+        {"blocks", number_setter(config.blocks_per_iteration)},
+        {"min_size", number_setter(config.min_size)},
+        {"max_size", number_setter(config.max_size)},
+        {"lifetime", number_setter(config.mean_lifetime)},
+    };
+    for (auto& option : options) {
+        auto eq = option.find('=');
+        auto setter = setters.find(option.substr(0, eq));
+        if (eq == std::string::npos || setter == setters.end()) {
+            std::cout << "unknown option " << option << std::endl;
+            return false;
         }
-        auto free = free_map.find(i);
-        if (free != free_map.end()) {
-            alloc_mgr.collect_trace(
-                reinterpret_cast<void*>(free->second.first), static_cast<int64_t>(-free->second.second));
+        if (!setter->second(option.substr(eq + 1))) {
+            std::cout << "bad value in option " << option << std::endl;
+            return false;
         }
     }
 
-    alloc_mgr.test_simulator();
+    auto start = std::chrono::steady_clock::now();
+    c10::cuda::AllocatorSim::workloadGenerator generator(config);
+    uint64_t num_blocks = 0;
+    uint64_t num_events = 0;
+    bool written = false;
+    if (fs::path(output_file).extension() == ".bin") {
+        c10::cuda::AllocatorSim::binaryTraceWriter writer(output_file);
+        num_events = generator.generate([&](const c10::cuda::AllocatorSim::TraceBlock& b) {
+            writer.add(b.malloc_op_id, b.free_op_id, b.size);
+        });
+        num_blocks = writer.get_num_blocks();
+        written = writer.close();
+    } else {
+        c10::cuda::AllocatorSim::textTraceWriter writer(output_file);
+        num_events = generator.generate([&](const c10::cuda::AllocatorSim::TraceBlock& b) {
+            writer.add(b.malloc_op_id, b.free_op_id, b.size);
+            num_blocks++;
+        });
+        written = writer.close();
+    }
+    if (!written) {
+        std::cout << "cannot write " << output_file << std::endl;
+        return false;
+    }
+    auto duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+    std::cout << pattern << ": " << num_blocks << " blocks, " << num_events << " events, "
+              << fs::file_size(output_file) << " B in " << duration.count() << " s" << std::endl;
+    return true;
+}
+
+// a .bin output is in the binary format, otherwise in the text one, false if a write failed
+bool write_trace(const std::string& output_file, const trace_type_t& block_map) {
+    if (fs::path(output_file).extension() == ".bin") {
+        c10::cuda::AllocatorSim::binaryTraceWriter writer(output_file);
+        writer.add(block_map);
+        return writer.close();
+    }
+    c10::cuda::AllocatorSim::textTraceWriter writer(output_file);
+    for (auto& b : block_map) {
+        writer.add(b.first, b.second.first, b.second.second);
+    }
+    return writer.close();
+}
+
+// write the op_id or iteration window [first, last) of a trace with a prologue of its live blocks
+bool slice_trace(const std::string& trace_file, const std::string& output_file,
+                 const std::string& unit, uint64_t first, uint64_t last) {
+    if (unit != "iter" && unit != "op") {
+        std::cout << "unknown window unit " << unit << ", iter or op" << std::endl;
+        return false;
+    }
+    trace_type_t block_map;
+    if (!process_trace(trace_file, block_map)) {
+        return false;
+    }
+
+    c10::cuda::AllocatorSim::traceSlicer slicer(block_map);
+    auto window = std::make_pair(first, last);
+    if (unit == "iter") {
+        window = slicer.get_iteration_window(first, last);
+    }
+    trace_type_t sliced;
+    auto info = slicer.slice(window.first, window.second, sliced);
+    if (!write_trace(output_file, sliced)) {
+        std::cout << "cannot write " << output_file << std::endl;
+        return false;
+    }
+
+    std::cout << "iterations: " << slicer.get_num_iterations() << ", window: [" << window.first << ", "
+              << window.second << ")" << std::endl;
+    std::cout << "blocks: " << info.num_prologue_blocks << " in the prologue, " << info.num_window_blocks
+              << " in the window, " << info.num_live_blocks << " live after it, the window starts at op_id "
+              << info.window_start << std::endl;
+    return true;
 }
 
 int main(int argc, char** argv) {
-    if (argc != 3) {
-        std::cout << "Usage: ./bin/allocatorsim <trace_file> <allocator_config_file>" << std::endl;
+    if (argc == 4 && std::string(argv[1]) == "--compress") {
+        return compress_trace(argv[2], argv[3]) ? 0 : 1;
+    }
+    if (argc == 4 && std::string(argv[1]) == "--binary") {
+        return write_binary_trace(argv[2], argv[3]) ? 0 : 1;
+    }
+    if ((argc == 4 || argc == 5) && std::string(argv[1]) == "--import") {
+        int device = 0;
+        if (argc == 5 && (!parse_number(argv[4], device) || device < 0)) {
+            std::cout << "bad device " << argv[4] << std::endl;
+            return 1;
+        }
+        return import_snapshot(argv[2], argv[3], device) ? 0 : 1;
+    }
+    if (argc >= 4 && std::string(argv[1]) == "--generate") {
+        return generate_workload(argv[2], argv[3], std::vector<std::string>(argv + 4, argv + argc)) ? 0 : 1;
+    }
+    if (argc == 7 && std::string(argv[1]) == "--slice") {
+        uint64_t first = 0;
+        uint64_t last = 0;
+        if (!parse_number(argv[5], first) || !parse_number(argv[6], last)) {
+            std::cout << "bad window " << argv[5] << " " << argv[6] << std::endl;
+            return 1;
+        }
+        return slice_trace(argv[2], argv[3], argv[4], first, last) ? 0 : 1;
+    }
+    if (argc >= 2 && std::string(argv[1]) == "--bench-collect") {
+        size_t num_events = 1000000;
+        size_t num_threads = 1;
+        if ((argc >= 3 && !parse_number(argv[2], num_events)) || (argc >= 4 && !parse_number(argv[3], num_threads))) {
+            std::cout << "bad number of events or threads" << std::endl;
+            return 1;
+        }
+        bench_collect_trace(num_events, num_threads);
+        return 0;
+    }
+    if (argc < 3) {
+        std::cout << "Usage: ./bin/allocatorsim <trace_file> <allocator_config_file> [option=value ...]" << std::endl;
+        std::cout << "       ./bin/allocatorsim --bench-collect [num_events] [num_threads]" << std::endl;
+        std::cout << "       ./bin/allocatorsim --compress <trace_file> <output_file>" << std::endl;
+        std::cout << "       ./bin/allocatorsim --binary <trace_file> <output_file>" << std::endl;
+        std::cout << "       ./bin/allocatorsim --import <snapshot.json> <output_file> [device]" << std::endl;
+        std::cout << "       ./bin/allocatorsim --generate <pattern> <output_file> [option=value ...]" << std::endl;
+        std::cout << "       ./bin/allocatorsim --slice <trace_file> <output_file> <iter|op> <first> <last>" << std::endl;
         return 0;
     }
 
@@ -98,15 +574,49 @@ int main(int argc, char** argv) {
     std::string trace_file = argv[1];
     std::string config_file = argv[2];
 
-    trace_type_t input_block_map;
-    trace_type malloc_map;
-    trace_type free_map;
-    uint64_t min, max;
-
-    std::tie(min, max) = process_trace(trace_file, input_block_map);
-
-    generate_trace(input_block_map, malloc_map, free_map);
-    run_allocator(malloc_map, free_map, min, max);
+    // segment_op_mb: the reserved MB a cudaMalloc or cudaFree is worth in the config search,
+    // fragmentation_weight: the same for a byte of fragmentation, latency: a latency table file,
+    // config_store: a directory to reuse and keep the searched configs in
+    c10::cuda::AllocatorSim::SearchTradeoff tradeoff;
+    std::string latency_file;
+    const std::map<std::string, option_setter_t> setters {
+        {"segment_op_mb", [&](const std::string& v) {
+            double mb = 0;
+            if (!parse_number(v, mb) || mb < 0 || mb >= std::numeric_limits<size_t>::max() / 1048576.0) {
+                return false;
+            }
+            tradeoff.segment_op_bytes = static_cast<size_t>(mb * 1048576);
+            return true;
+        }},
+        {"fragmentation_weight", [&](const std::string& v) {
+            return parse_number(v, tradeoff.fragmentation_weight) && tradeoff.fragmentation_weight >= 0;
+        }},
+        {"latency", [&](const std::string& v) {
+            latency_file = v;
+            return true;
+        }},
+        {"config_store", [&](const std::string& v) {
+            c10::cuda::AllocatorSim::set_config_store(v);
+            return true;
+        }},
+    };
+    for (int i = 3; i < argc; i++) {
+        std::string option = argv[i];
+        auto eq = option.find('=');
+        auto setter = setters.find(option.substr(0, eq));
+        if (eq == std::string::npos || setter == setters.end()) {
+            std::cout << "unknown option " << option << std::endl;
+            return 1;
+        }
+        if (!setter->second(option.substr(eq + 1))) {
+            std::cout << "bad value in option " << option << std::endl;
+            return 1;
+        }
+    }
+    c10::cuda::AllocatorSim::set_search_tradeoff(tradeoff);
+    if (!latency_file.empty() && !c10::cuda::AllocatorSim::load_latency_model(latency_file)) {
+        return 1;
+    }
 
-    return 0;
+    return run_allocator(trace_file) ? 0 : 1;
 }
@@ -0,0 +1,405 @@
+"""
+Round-trip and regression tests of the trace file formats and the command line.
+
+    python3 test/test_trace_files.py [path/to/allocatorsim]
+
+The simulator defaults to ./bin/allocatorsim or $ALLOCATORSIM. Every test runs
+the binary on small traces written to a temporary directory: the text, binary,
+compressed and snapshot loaders, the truncated and corrupt inputs they must
+reject, the period detector, slicing and the command line parsing.
+"""
+import json
+import os
+import random
+import struct
+import subprocess
+import sys
+import tempfile
+import unittest
+
+REPO_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+SIMULATOR = os.environ.get("ALLOCATORSIM", os.path.join(REPO_DIR, "bin", "allocatorsim"))
+ALEXNET_TRACE = os.path.join(REPO_DIR, "input", "alexnet_train.log")
+
+BINARY_MAGIC = b"ASIMTRC\0"
+# the op_id after the last one, a slice window to the end of a trace
+END_OP_ID = 2**64 - 1
+
+
+def run(*args, timeout=600):
+    result = subprocess.run([SIMULATOR] + [str(a) for a in args], stdout=subprocess.PIPE,
+                            stderr=subprocess.STDOUT, universal_newlines=True, timeout=timeout)
+    return result.returncode, result.stdout
+
+
+def periodic_blocks(num_iterations, blocks_per_iteration=20, patched=()):
+    """(malloc_op_id, free_op_id, size) of iterations that malloc then free the same sizes,
+    patched holds the (iteration, block) whose size differs"""
+    blocks = []
+    op_id = 0
+    for it in range(num_iterations):
+        mallocs = []
+        for k in range(blocks_per_iteration):
+            size = (k + 1) * 4096 + (512 if (it, k) in patched else 0)
+            mallocs.append((op_id, size))
+            op_id += 1
+        for malloc_op_id, size in mallocs:
+            blocks.append((malloc_op_id, op_id, size))
+            op_id += 1
+    return sorted(blocks)
+
+
+def write_text(path, blocks):
+    with open(path, "w") as f:
+        for b in blocks:
+            f.write("%d %d %d\n" % b)
+
+
+def read_text(path):
+    with open(path) as f:
+        return sorted(tuple(int(v) for v in line.split()) for line in f if line.strip())
+
+
+def varint(value):
+    out = bytearray()
+    while value >= 0x80:
+        out.append((value & 0x7f) | 0x80)
+        value >>= 7
+    out.append(value)
+    return bytes(out)
+
+
+def zigzag(from_op_id, to_op_id):
+    diff = (to_op_id - from_op_id) & (2**64 - 1)
+    if diff >= 2**63:
+        diff -= 2**64
+    return ((diff << 1) ^ (diff >> 63)) & (2**64 - 1)
+
+
+def binary_trace(blocks, version=2):
+    """the binary format, version 1 has the sizes before the records"""
+    sizes = []
+    index = {}
+    records = bytearray()
+    prev = 0
+    for malloc_op_id, free_op_id, size in blocks:
+        if size not in index:
+            index[size] = len(sizes)
+            sizes.append(size)
+        records += varint(zigzag(prev, malloc_op_id))
+        records += varint(zigzag(malloc_op_id, free_op_id))
+        records += varint(index[size])
+        prev = malloc_op_id
+    header = BINARY_MAGIC + struct.pack("<IIQQ", version, len(sizes), len(blocks), len(records))
+    dictionary = b"".join(struct.pack("<Q", s) for s in sizes)
+    if version == 1:
+        return header + dictionary + bytes(records)
+    return header + bytes(records) + dictionary
+
+
+def snapshot(entries):
+    return {"segments": [], "device_traces": [entries]}
+
+
+class TraceFileTest(unittest.TestCase):
+    def setUp(self):
+        self.tmp = tempfile.TemporaryDirectory()
+
+    def tearDown(self):
+        self.tmp.cleanup()
+
+    def path(self, name):
+        return os.path.join(self.tmp.name, name)
+
+    def decode(self, trace_file):
+        """the blocks of any trace format, through a slice of the whole trace to text"""
+        out = self.path("decoded.log")
+        code, output = run("--slice", trace_file, out, "op", 0, END_OP_ID)
+        self.assertEqual(code, 0, output)
+        return read_text(out)
+
+    def assert_rejected(self, trace_file, message):
+        code, output = run(trace_file, "-")
+        self.assertEqual(code, 1, output)
+        self.assertIn(message, output)
+
+
+class RoundTripTest(TraceFileTest):
+    def test_text_to_binary(self):
+        blocks = periodic_blocks(8)
+        write_text(self.path("t.log"), blocks)
+        code, output = run("--binary", self.path("t.log"), self.path("t.bin"))
+        self.assertEqual(code, 0, output)
+        self.assertIn("lossless: true", output)
+        self.assertEqual(self.decode(self.path("t.bin")), blocks)
+
+    def test_alexnet_to_binary(self):
+        code, output = run("--binary", ALEXNET_TRACE, self.path("a.bin"))
+        self.assertEqual(code, 0, output)
+        self.assertIn("lossless: true", output)
+        self.assertEqual(self.decode(self.path("a.bin")), read_text(ALEXNET_TRACE))
+
+    def test_out_of_order_blocks(self):
+        # a free before its malloc and a malloc delta going back both round-trip
+        blocks = [(5, 3, 512), (2, 9, 1024), (7, 8, 512)]
+        with open(self.path("o.bin"), "wb") as f:
+            f.write(binary_trace(blocks))
+        code, output = run("--binary", self.path("o.bin"), self.path("o2.bin"))
+        self.assertEqual(code, 0, output)
+        self.assertIn("lossless: true", output)
+
+    def test_binary_version_1(self):
+        blocks = periodic_blocks(3)
+        with open(self.path("v1.bin"), "wb") as f:
+            f.write(binary_trace(blocks, version=1))
+        self.assertEqual(self.decode(self.path("v1.bin")), blocks)
+
+    def test_binary_written_by_simulator(self):
+        blocks = periodic_blocks(4)
+        write_text(self.path("t.log"), blocks)
+        run("--binary", self.path("t.log"), self.path("t.bin"))
+        with open(self.path("t.bin"), "rb") as f:
+            self.assertEqual(f.read(), binary_trace(blocks))
+
+    def test_compressed(self):
+        blocks = periodic_blocks(10, patched={(4, 3)})
+        write_text(self.path("t.log"), blocks)
+        code, output = run("--compress", self.path("t.log"), self.path("t.ctr"))
+        self.assertEqual(code, 0, output)
+        self.assertIn("lossless: true", output)
+        self.assertEqual(self.decode(self.path("t.ctr")), blocks)
+
+    def test_generated_binary(self):
+        code, output = run("--generate", "transformer", self.path("g.bin"), "iterations=3", "seed=7")
+        self.assertEqual(code, 0, output)
+        code, output = run("--generate", "transformer", self.path("g.log"), "iterations=3", "seed=7")
+        self.assertEqual(code, 0, output)
+        self.assertEqual(self.decode(self.path("g.bin")), read_text(self.path("g.log")))
+
+    def test_snapshot_import(self):
+        entries = [
+            {"action": "free_completed", "addr": 99, "size": 512, "stream": 0},
+            {"action": "alloc", "addr": 1, "size": 512, "stream": 0},
+            {"action": "alloc", "addr": 2, "size": 2 << 20, "stream": 0},
+            {"action": "free_requested", "addr": 1, "size": 512, "stream": 0},
+            {"action": "free_completed", "addr": 1, "size": 512, "stream": 0},
+            {"action": "alloc", "addr": 1, "size": 1024, "stream": 0},
+        ]
+        with open(self.path("s.json"), "w") as f:
+            json.dump(snapshot(entries), f)
+        code, output = run("--import", self.path("s.json"), self.path("s.bin"))
+        self.assertEqual(code, 0, output)
+        self.assertIn("1 frees of earlier blocks", output)
+        # the live blocks are freed at one last op_id
+        self.assertEqual(self.decode(self.path("s.bin")), [(0, 2, 512), (1, 4, 2 << 20), (3, 4, 1024)])
+
+    def test_replay_formats_agree(self):
+        blocks = periodic_blocks(6)
+        write_text(self.path("t.log"), blocks)
+        run("--binary", self.path("t.log"), self.path("t.bin"))
+        run("--compress", self.path("t.log"), self.path("t.ctr"))
+        results = []
+        for name in ("t.log", "t.bin", "t.ctr"):
+            code, output = run(self.path(name), "-")
+            self.assertEqual(code, 0, output)
+            results.append([line for line in output.splitlines()
+                             if line.startswith("Max reserved size:") or line.startswith("Allocator overhead:")])
+        self.assertEqual(results[0], results[1])
+        self.assertEqual(results[0], results[2])
+
+
+class CorruptInputTest(TraceFileTest):
+    def write_binary(self, data):
+        with open(self.path("c.bin"), "wb") as f:
+            f.write(data)
+        return self.path("c.bin")
+
+    def test_truncated_binary(self):
+        data = binary_trace(periodic_blocks(4))
+        for length in (len(BINARY_MAGIC), 20, 40, len(data) - 1):
+            self.assert_rejected(self.write_binary(data[:length]), "bad header or unknown version")
+
+    def test_bad_binary_version(self):
+        data = bytearray(binary_trace(periodic_blocks(2)))
+        data[8] = 9
+        self.assert_rejected(self.write_binary(bytes(data)), "bad header or unknown version")
+
+    def test_unfinished_binary(self):
+        # the header is written last, an interrupted writer leaves zeros
+        data = bytearray(binary_trace(periodic_blocks(2)))
+        data[:32] = bytes(32)
+        self.assert_rejected(self.write_binary(bytes(data)), "bad trace line")
+
+    def test_corrupt_binary_records(self):
+        blocks = periodic_blocks(2)
+        data = binary_trace(blocks)
+        header, rest = data[:32], data[32:]
+        num_records_bytes = struct.unpack("<Q", header[24:32])[0]
+        records, dictionary = rest[:num_records_bytes], rest[num_records_bytes:]
+        # a size index past the dictionary
+        bad_index = records[:-1] + bytes([0x7f])
+        self.assert_rejected(self.write_binary(header + bad_index + dictionary), "the records are truncated")
+        # a varint that does not end
+        unterminated = records[:-1] + bytes([0x80])
+        self.assert_rejected(self.write_binary(header + unterminated + dictionary), "the records are truncated")
+        # fewer records than blocks in the header
+        fewer = bytearray(header)
+        fewer[16:24] = struct.pack("<Q", len(blocks) + 1)
+        self.assert_rejected(self.write_binary(bytes(fewer) + records + dictionary), "the records are truncated")
+
+    def test_truncated_compressed(self):
+        write_text(self.path("t.log"), periodic_blocks(8))
+        run("--compress", self.path("t.log"), self.path("t.ctr"))
+        with open(self.path("t.ctr"), "rb") as f:
+            data = f.read()
+        for length in (30, len(data) // 2, len(data) - 2):
+            with open(self.path("c.ctr"), "wb") as f:
+                f.write(data[:length])
+            code, output = run(self.path("c.ctr"), "-")
+            self.assertEqual(code, 1, "%d bytes: %s" % (length, output))
+
+    def test_truncated_snapshot(self):
+        text = json.dumps(snapshot([{"action": "alloc", "addr": 1, "size": 512, "stream": 0}]))
+        for length in (1, len(text) // 2, len(text) - 1):
+            with open(self.path("t.json"), "w") as f:
+                f.write(text[:length])
+            code, output = run("--import", self.path("t.json"), self.path("t.bin"))
+            self.assertEqual(code, 1, "%d bytes: %s" % (length, output))
+
+    def test_snapshot_without_traces(self):
+        with open(self.path("n.json"), "w") as f:
+            json.dump({"segments": []}, f)
+        code, output = run("--import", self.path("n.json"), self.path("n.bin"))
+        self.assertEqual(code, 1, output)
+        self.assertIn("no device_traces", output)
+
+    def test_multi_stream_snapshot(self):
+        entries = [
+            {"action": "alloc", "addr": 1, "size": 512, "stream": 0},
+            {"action": "alloc", "addr": 2, "size": 512, "stream": 7},
+        ]
+        with open(self.path("m.json"), "w") as f:
+            json.dump(snapshot(entries), f)
+        code, output = run("--import", self.path("m.json"), self.path("m.bin"))
+        self.assertEqual(code, 1, output)
+        self.assertIn("2 streams", output)
+
+    def test_missing_files(self):
+        code, output = run("--import", self.path("missing.json"), self.path("m.bin"))
+        self.assertEqual(code, 1, output)
+        self.assert_rejected(self.path("missing.log"), "cannot read")
+
+    def test_bad_text_line(self):
+        with open(self.path("b.log"), "w") as f:
+            f.write("0 1 512\n2 x 512\n")
+        self.assert_rejected(self.path("b.log"), "bad trace line: 2 x 512")
+
+
+class PeriodTest(TraceFileTest):
+    def iterations(self, blocks):
+        """the iterations compressedTrace finds with detect_period()"""
+        write_text(self.path("p.log"), blocks)
+        code, output = run("--compress", self.path("p.log"), self.path("p.ctr"))
+        self.assertEqual(code, 0, output)
+        self.assertIn("lossless: true", output)
+        return int(output.split("iterations: ")[1].split(",")[0])
+
+    def test_periodic(self):
+        self.assertEqual(self.iterations(periodic_blocks(8)), 8)
+
+    def test_patched_iterations(self):
+        self.assertEqual(self.iterations(periodic_blocks(10, patched={(2, 5), (7, 11)})), 10)
+
+    def test_too_short(self):
+        # a period is only accepted over at least 16 blocks
+        self.assertEqual(self.iterations(periodic_blocks(3, blocks_per_iteration=4)), 1)
+
+    def test_aperiodic(self):
+        rng = random.Random(1)
+        blocks = [(2 * i, 2 * i + 1, rng.randrange(1, 1 << 20) * 512) for i in range(400)]
+        self.assertEqual(self.iterations(blocks), 1)
+
+    def test_constant_tail(self):
+        # every offset into a long constant tail looks like a period at first, they are
+        # rejected in linear time instead of one full comparison each
+        rng = random.Random(1)
+        blocks = [(2 * i, 2 * i + 1, rng.randrange(1, 1 << 20) * 512) for i in range(200000)]
+        op_id = 2 * len(blocks)
+        blocks += [(op_id + 2 * i, op_id + 2 * i + 1, 4096) for i in range(20000)]
+        write_text(self.path("p.log"), blocks)
+        code, output = run("--compress", self.path("p.log"), self.path("p.ctr"), timeout=30)
+        self.assertEqual(code, 0, output)
+        self.assertIn("iterations: 1,", output)
+
+
+class SliceTest(TraceFileTest):
+    def test_iteration_window(self):
+        write_text(self.path("t.log"), periodic_blocks(8))
+        code, output = run("--slice", self.path("t.log"), self.path("s.log"), "iter", 2, 4)
+        self.assertEqual(code, 0, output)
+        self.assertIn("iterations: 8, window: [80, 160)", output)
+        self.assertEqual(read_text(self.path("s.log")), periodic_blocks(2))
+
+    def test_live_blocks_prologue(self):
+        # a block malloced before the window and freed in it is replayed from a prologue
+        blocks = [(0, 5, 1 << 20), (1, 2, 512), (3, 4, 1024), (6, 7, 2048)]
+        write_text(self.path("t.log"), blocks)
+        code, output = run("--slice", self.path("t.log"), self.path("s.bin"), "op", 3, 7)
+        self.assertEqual(code, 0, output)
+        self.assertIn("1 in the prologue", output)
+        self.assertIn("2 in the window", output)
+        self.assertEqual(len(self.decode(self.path("s.bin"))), 3)
+
+    def test_bad_window(self):
+        write_text(self.path("t.log"), periodic_blocks(2))
+        code, output = run("--slice", self.path("t.log"), self.path("s.log"), "iter", 1, "x")
+        self.assertEqual(code, 1, output)
+        code, output = run("--slice", self.path("t.log"), self.path("s.log"), "step", 0, 1)
+        self.assertEqual(code, 1, output)
+
+
+class CommandLineTest(TraceFileTest):
+    def test_bad_option_values(self):
+        write_text(self.path("t.log"), periodic_blocks(2))
+        for option in ("segment_op_mb=-1", "segment_op_mb=abc", "segment_op_mb=1e30",
+                       "fragmentation_weight=nan", "fragmentation_weight=", "unknown=1", "segment_op_mb"):
+            code, output = run(self.path("t.log"), "-", option)
+            self.assertEqual(code, 1, option + ": " + output)
+
+    def test_bad_generate_options(self):
+        for option in ("iterations=abc", "iterations=-3", "seed=1.5", "jitter=inf", "layers=12x"):
+            code, output = run("--generate", "cnn", self.path("g.log"), option)
+            self.assertEqual(code, 1, option + ": " + output)
+            self.assertIn("bad value in option " + option, output)
+
+    def test_bad_arguments(self):
+        self.assertEqual(run("--import", self.path("s.json"), self.path("s.bin"), "-1")[0], 1)
+        self.assertEqual(run("--bench-collect", "1e5")[0], 1)
+        self.assertEqual(run("--generate", "unknown", self.path("g.log"))[0], 1)
+
+    def test_config_store(self):
+        write_text(self.path("t.log"), periodic_blocks(4))
+        store = self.path("store")
+        code, output = run(self.path("t.log"), "-", "config_store=" + store)
+        self.assertEqual(code, 0, output)
+        self.assertEqual([f for f in os.listdir(store) if not f.endswith(".txt")], [])
+        code, output = run(self.path("t.log"), "-", "config_store=" + store)
+        self.assertEqual(code, 0, output)
+        self.assertIn("reuse the configs", output)
+        # a store under a file is reported instead of throwing
+        code, output = run(self.path("t.log"), "-", "config_store=" + self.path("t.log/store"))
+        self.assertEqual(code, 0, output)
+        self.assertIn("cannot create", output)
+
+    def test_unwritable_output(self):
+        code, output = run("--binary", ALEXNET_TRACE, self.path("missing/a.bin"))
+        self.assertEqual(code, 1, output)
+        self.assertIn("cannot write", output)
+
+
+if __name__ == "__main__":
+    if len(sys.argv) > 1 and not sys.argv[1].startswith("-"):
+        SIMULATOR = os.path.abspath(sys.argv.pop(1))
+    if not os.path.isfile(SIMULATOR):
+        sys.exit("no simulator at %s, build it or pass its path" % SIMULATOR)
+    unittest.main()